@@ -0,0 +1,71 @@
+#include "FormulaCache.hpp"
+#include <QtDebug>
+#include <QFile>
+#include <QPainter>
+#include <QPixmapCache>
+#include <QSvgRenderer>
+
+const QHash<QString, FormulaCache::Entry> &FormulaCache::manifest()
+{
+    static const QHash<QString, Entry> entries = [] {
+        QHash<QString, Entry> entries;
+        QFile file(":/latex/formulas.manifest");
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            qWarning() << "Cannot open formula manifest";
+            return entries;
+        }
+
+        while (!file.atEnd()) {
+            QStringList fields = QString::fromUtf8(file.readLine())
+                .split(' ', Qt::SkipEmptyParts);
+            if (fields.size() == 3) {
+                entries.insert(fields[0], {fields[1], fields[2].trimmed()});
+            }
+        }
+        return entries;
+    }();
+    return entries;
+}
+
+QString FormulaCache::resourcePath(const QString &name)
+{
+    auto it = manifest().constFind(name);
+    if (it == manifest().constEnd()) {
+        return QString(":/latex/%1.svg").arg(name);
+    }
+    return ":/latex/" + it->file;
+}
+
+QString FormulaCache::contentHash(const QString &name)
+{
+    return manifest().value(name).hash;
+}
+
+QPixmap FormulaCache::pixmap(const QString &name, int height, qreal dpr)
+{
+    QString key = QString("formula:%1:%2:%3:%4")
+        .arg(name, contentHash(name)).arg(height).arg(dpr);
+    QPixmap pixmap;
+    if (QPixmapCache::find(key, &pixmap)) {
+        return pixmap;
+    }
+
+    QSvgRenderer renderer(resourcePath(name));
+    if (!renderer.isValid()) {
+        qWarning() << "Cannot load formula" << name;
+        return pixmap;
+    }
+
+    QSize size = renderer.defaultSize();
+    size.scale(height, height, Qt::KeepAspectRatioByExpanding);
+    pixmap = QPixmap(size * dpr);
+    pixmap.setDevicePixelRatio(dpr);
+    pixmap.fill(Qt::transparent);
+
+    QPainter painter(&pixmap);
+    renderer.render(&painter, QRectF(QPointF(), size));
+    painter.end();
+
+    QPixmapCache::insert(key, pixmap);
+    return pixmap;
+}
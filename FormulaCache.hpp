@@ -0,0 +1,30 @@
+#ifndef FORMULACACHE_HPP
+#define FORMULACACHE_HPP
+
+#include <QHash>
+#include <QMetaType>
+#include <QPixmap>
+#include <QString>
+
+struct Formula {
+    QString name;
+};
+
+Q_DECLARE_METATYPE(Formula);
+
+class FormulaCache {
+public:
+    static QString resourcePath(const QString &name);
+    static QString contentHash(const QString &name);
+    static QPixmap pixmap(const QString &name, int height, qreal dpr = 1.0);
+
+private:
+    struct Entry {
+        QString hash;
+        QString file;
+    };
+
+    static const QHash<QString, Entry> &manifest();
+};
+
+#endif
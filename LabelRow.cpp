@@ -3,6 +3,7 @@
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QSvgRenderer>
+#include "FormulaCache.hpp"
 
 LabelRow::LabelRow(const QList<QVariant> &items, const QFont &font,
                    QWidget *parent)
@@ -13,6 +14,11 @@ LabelRow::LabelRow(const QList<QVariant> &items, const QFont &font,
         QWidget *widget;
         if (qstrcmp(item.typeName(), "int") == 0) {
             widget = new QLabel(QString(item.toInt(), ' '));
+        } else if (item.canConvert<Formula>()) {
+            QLabel *label = new QLabel();
+            label->setProperty("formula", item.value<Formula>().name);
+            setFormulaPixmap(label, fontHeight);
+            widget = label;
         } else if (item.canConvert<QString>()) {
             widget = new QLabel(item.toString());
         } else if (item.canConvert<QPixmap>()) {
@@ -42,7 +48,11 @@ void LabelRow::changeEvent(QEvent *ev)
         int fontHeight = fontMetrics().height();
         for (auto &w : widgets) {
             if (auto label = dynamic_cast<QLabel*>(w.get())) {
-                resizePixmapLabel(label, fontHeight);
+                if (label->property("formula").isValid()) {
+                    setFormulaPixmap(label, fontHeight);
+                } else {
+                    resizePixmapLabel(label, fontHeight);
+                }
             } else if (auto svg = dynamic_cast<QSvgWidget*>(w.get())) {
                 resizeSvg(svg, fontHeight);
             }
@@ -58,6 +68,12 @@ void LabelRow::resizePixmapLabel(QLabel *label, int height)
     }
 }
 
+void LabelRow::setFormulaPixmap(QLabel *label, int height)
+{
+    QString name = label->property("formula").toString();
+    label->setPixmap(FormulaCache::pixmap(name, height, label->devicePixelRatioF()));
+}
+
 void LabelRow::resizeSvg(QSvgWidget *svg, int height)
 {
     QSize size = svg->renderer()->defaultSize();
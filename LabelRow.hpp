@@ -17,6 +17,7 @@ protected:
     void changeEvent(QEvent *ev) override;
 private:
     static void resizePixmapLabel(QLabel *label, int height);
+    static void setFormulaPixmap(QLabel *label, int height);
     static void resizeSvg(QSvgWidget *svg, int height);
     void initLayout();
     QList<QSharedPointer<QWidget>> widgets;
@@ -4,38 +4,30 @@
 #include <algorithm>
 #include <functional>
 #include <memory>
+#include <unordered_set>
 #include <QtDebug>
 #include <QMouseEvent>
-
-void MclWidget::paintNode(const MclNode *node, QPainter &painter, 
-                          const QPointF &center, const QString &rtag)
+#include <QPaintEvent>
+#include <QWheelEvent>
+#include <QCursor>
+#include <QScrollBar>
+#include <QFontMetricsF>
+#include <QtConcurrent>
+
+QRectF MclWidget::nodeBounds(const QPointF &center, qreal tagWidth)
 {
-    QString text = QString::fromStdString(*node);
-    QString vhText = QString::number(node->vh());
-    QRectF rect(0, 0, nodeWidth, nodeHeight);
+    QRectF rect(0, 0, nodeWidth + 2 * (tagGap + tagWidth), nodeHeight + 4);
     rect.moveCenter(center);
-    painter.drawArc(rect, 0, 16 * 360);
-    painter.drawText(rect, Qt::AlignCenter, text);
-
-    QFont pfont(painter.font());
-    QFont tagFont;
-    tagFont.setPointSize(8);
-    painter.setFont(tagFont);
-    int vhWidth = painter.fontMetrics().size(0, vhText).width();
-    QRectF vhRect = rect.translated(-vhWidth - 5, 0);
-    painter.drawText(vhRect, Qt::AlignLeft | Qt::AlignVCenter, vhText);
-    
-    if (rtag.size() > 0) {
-        int rtagWidth = painter.fontMetrics().size(0, rtag).width();
-        QRectF rtagRect = rect.translated(rtagWidth + 5, 0);
-        painter.drawText(rtagRect, Qt::AlignRight | Qt::AlignVCenter, rtag);
-    }
+    return rect;
+}
 
-    painter.setFont(pfont);
+QRectF MclWidget::edgeBounds(const QPointF &c1, const QPointF &c2)
+{
+    QRectF rect = QRectF(c1, c2).normalized();
+    return rect.adjusted(-hMargin / 2, 0, hMargin / 2, 0);
 }
 
-void MclWidget::paintEdge(QPainter &painter, const QPointF &c1,
-                          const QPointF &c2, const QString &tag)
+QLineF MclWidget::edgeLine(const QPointF &c1, const QPointF &c2)
 {
     using std::sqrt;
     using std::pow;
@@ -51,7 +43,6 @@ void MclWidget::paintEdge(QPainter &painter, const QPointF &c1,
     double ey1;
     double ex2;
     double ey2;
-    int slopeSgn;
 
     if (x1 != x2) {
         double m = (y2 - y1) / (x2 - x1);
@@ -61,27 +52,23 @@ void MclWidget::paintEdge(QPainter &painter, const QPointF &c1,
         ey1 = m * (ex1 - x1) + y1;
         ex2 = x2 - sgn * k;
         ey2 = m * (ex2 - x2) + y2;
-        slopeSgn = m > 0 ? 1 : -1;
     } else {
         int sgn = y1 < y2 ? 1 : -1;
         ex1 = x1;
         ey1 = y1 + sgn * b;
         ex2 = x2;
         ey2 = y2 - sgn * b;
-        slopeSgn = 0;
     }
 
-    QLineF line(ex1, ey1, ex2, ey2);
-    painter.drawLine(line);
-
-    if (tag.length() == 0) {
-        return;
-    }
+    return QLineF(ex1, ey1, ex2, ey2);
+}
 
-    QSizeF tsize(painter.fontMetrics().size(0, tag));
-    QRectF tagRect(QPointF(), tsize);
+QRectF MclWidget::edgeTagRect(const QLineF &line, const QSizeF &size)
+{
+    QRectF tagRect(QPointF(), size);
+    bool negativeSlope = line.dx() != 0 && line.dy() / line.dx() < 0;
 
-    if (slopeSgn < 0) {
+    if (negativeSlope) {
         tagRect.moveBottomRight(line.center());
         tagRect.translate(-10.0, 0);
     } else {
@@ -89,59 +76,281 @@ void MclWidget::paintEdge(QPainter &painter, const QPointF &c1,
         tagRect.translate(10.0, 0);
     }
 
-    painter.drawText(tagRect, Qt::AlignCenter, tag);
+    return tagRect;
+}
+
+QColor MclWidget::displayColor(DisplayItem::Color color)
+{
+    switch (color) {
+    case DisplayItem::Current:
+        return QColor("darkred");
+    case DisplayItem::Path:
+        return QColor("green");
+    case DisplayItem::Hover:
+        return QColor("darkblue");
+    default:
+        return QColor();
+    }
+}
+
+QString MclWidget::opTag(int op)
+{
+    return op < 26 ? QString(QChar('A' + op)) : QString::number(op);
+}
+
+MclWidget::Glyphs::Glyphs(const QFont &f) : font{f}
+{
+    tagFont.setPointSize(8);
+    // Room for a sign and six digits, which fits every priority and +N tag
+    // the searches produce.
+    tagWidth = QFontMetricsF(tagFont).size(0, QStringLiteral("-000000")).width();
+}
+
+bool MclWidget::Glyphs::prepare(const QPen &p, qreal d)
+{
+    if (p == pen && d == dpr) {
+        return false;
+    }
+
+    pen = p;
+    dpr = d;
+    sprites.clear();
+
+    for (std::size_t op = 0; op < opSizes.size(); op++) {
+        opSprites[op] = opSprite(op);
+    }
+
+    return true;
+}
+
+QSizeF MclWidget::Glyphs::opSize(int op)
+{
+    if (std::size_t(op) >= opSizes.size()) {
+        QFontMetricsF fm(font);
+        for (int o = opSizes.size(); o <= op; o++) {
+            opSizes.push_back(fm.size(0, opTag(o)));
+            opSprites.push_back(dpr > 0 ? opSprite(o) : QImage());
+        }
+    }
+
+    return opSizes[op];
+}
+
+QImage MclWidget::Glyphs::opSprite(int op) const
+{
+    QImage image((opSizes[op] * dpr).toSize(), QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(dpr);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    painter.setPen(pen);
+    painter.setFont(font);
+    painter.drawText(QRectF(QPointF(), opSizes[op]), Qt::AlignCenter, opTag(op));
+    painter.end();
+    return image;
+}
+
+const QImage &MclWidget::Glyphs::sprite(const DisplayItem &item, DisplayItem::Color color)
+{
+    SpriteKey key{item.label, item.priority, item.dummyChildren, color};
+    auto it = sprites.find(key);
+    if (it != sprites.end()) {
+        return it->second;
+    }
+
+    QPen spen = pen;
+    QColor scolor = displayColor(color);
+    if (scolor.isValid()) {
+        spen.setColor(scolor);
+    }
+
+    QSizeF size = spriteSize();
+    QImage image((size * dpr).toSize(), QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(dpr);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    painter.setPen(spen);
+    painter.setFont(font);
+    QPointF center(size.width() / 2, size.height() / 2);
+    paintNode(painter, item, center, *this);
+    painter.end();
+
+    return sprites.emplace(key, image).first->second;
+}
+
+const QImage *MclWidget::Glyphs::findSprite(const DisplayItem &item,
+                                            DisplayItem::Color color) const
+{
+    auto it = sprites.find(SpriteKey{item.label, item.priority, item.dummyChildren, color});
+    return it != sprites.end() ? &it->second : nullptr;
+}
+
+QSizeF MclWidget::Glyphs::spriteSize() const
+{
+    return nodeBounds(QPointF(), tagWidth).size();
+}
+
+MclWidget::DisplayItem
+MclWidget::makeDisplayItem(const GeometryTraverse &g, Node node,
+                           const std::unordered_set<Node> &onPath, Glyphs &glyphs)
+{
+    const SearchView &view = g.view;
+    DisplayItem item;
+    item.node = node;
+    item.parent = view.parent(node);
+    item.label = QString::fromStdString(view.label(node));
+    item.priority = view.priority(node);
+    item.op = view.op(node);
+    item.center = g.pmap.at(node);
+
+    if (node == view.current()) {
+        item.color = DisplayItem::Current;
+    } else if (onPath.count(node) > 0) {
+        item.color = DisplayItem::Path;
+    } else {
+        item.color = DisplayItem::Plain;
+    }
+
+    SearchView::Nodes children;
+    item.dummyChildren = view.children(node, children);
+
+    if (item.parent != nullptr) {
+        item.edge = edgeLine(item.center, g.pmap.at(item.parent));
+        item.edgeTagPos = edgeTagRect(item.edge, glyphs.opSize(item.op)).topLeft();
+    }
+
+    return item;
+}
+
+std::vector<MclWidget::DisplayItem>
+MclWidget::buildDisplayList(const GeometryTraverse &g, const SearchView::Nodes &path,
+                            Glyphs &glyphs)
+{
+    std::unordered_set<Node> onPath(path.cbegin(), path.cend());
+    std::vector<DisplayItem> items;
+    items.reserve(g.pmap.size());
+
+    for (const auto &level : g.levels) {
+        for (const auto &node : level.nodes) {
+            items.push_back(makeDisplayItem(g, node, onPath, glyphs));
+        }
+    }
+
+    return items;
+}
+
+QSizeF MclWidget::layoutTree(GeometryTraverse &g, const QSizeF &minSize)
+{
+    double tw = g.width();
+    double th = g.height();
+    double w = std::max(minSize.width(), tw + 2 * treeHMargin);
+    double h = std::max(minSize.height(), th + 2 * treeVMargin);
+    double treeRectLeft = (w - tw) / 2;
+    double dx = treeRectLeft - g.leftmost.left();
+    double dy = treeVMargin + nodeHeight / 2;
+    g.translate(dx, dy);
+    g.index();
+    return QSizeF(w, h);
 }
 
-MclWidget::GeometryTraverse::GeometryTraverse(const MclTree &t)
-    : tree{t}, depth{0}
+void MclWidget::paintNode(QPainter &painter, const DisplayItem &item,
+                          const QPointF &center, const Glyphs &glyphs)
+{
+    QRectF rect(0, 0, nodeWidth, nodeHeight);
+    rect.moveCenter(center);
+    painter.drawArc(rect, 0, 16 * 360);
+
+    // Labels wider than the node, like those of the group puzzle, are
+    // drawn smaller rather than over the tags.
+    QFont pfont(painter.font());
+    qreal room = nodeWidth - 10;
+    qreal width = QFontMetricsF(pfont).size(0, item.label).width();
+    if (width > room && pfont.pointSizeF() > 0) {
+        QFont lfont(pfont);
+        lfont.setPointSizeF(pfont.pointSizeF() * room / width);
+        painter.setFont(lfont);
+    }
+    painter.drawText(rect, Qt::AlignCenter, item.label);
+
+    painter.setFont(glyphs.tagFont);
+    QRectF vhRect(rect.left() - tagGap - glyphs.tagWidth, rect.top(), glyphs.tagWidth,
+                  nodeHeight);
+    painter.drawText(vhRect, Qt::AlignRight | Qt::AlignVCenter,
+                     QString::number(item.priority));
+
+    if (item.dummyChildren > 0) {
+        QRectF rtagRect(rect.right() + tagGap, rect.top(), glyphs.tagWidth, nodeHeight);
+        painter.drawText(rtagRect, Qt::AlignLeft | Qt::AlignVCenter,
+                         QStringLiteral("+%1").arg(item.dummyChildren));
+    }
+
+    painter.setFont(pfont);
+}
+
+void MclWidget::paintEdge(QPainter &painter, const DisplayItem &item,
+                          const Glyphs &glyphs)
+{
+    if (item.parent == nullptr) {
+        return;
+    }
+
+    painter.drawLine(item.edge);
+    int op = item.op;
+    if (!glyphs.opSprites[op].isNull()) {
+        painter.drawImage(item.edgeTagPos, glyphs.opSprites[op]);
+    } else {
+        QRectF tagRect(item.edgeTagPos, glyphs.opSizes[op]);
+        painter.drawText(tagRect, Qt::AlignCenter, opTag(item.op));
+    }
+}
+
+MclWidget::GeometryTraverse::GeometryTraverse(const SearchView &v)
+    : view{v}, depth{0}
 {
     QPointF nullPoint;
-    pmap[tree.root] = nullPoint;
+    pmap[view.root()] = nullPoint;
     QRectF rect(0, 0, nodeWidth, nodeHeight);
     rect.moveCenter(nullPoint);
     leftmost = rect;
     rightmost = rect;
 }
 
-void MclWidget::GeometryTraverse::operator()(const MclNode *node)
+void MclWidget::GeometryTraverse::operator()(Node node)
 {
     using namespace std::placeholders;
 
-    MclNode *node_ = const_cast<MclNode*>(node);
-    if (node->depth > depth) {
-        depth = node->depth;
+    int ndepth = view.depth(node);
+    int reach = ndepth + view.expanded(node);
+    if (reach > depth) {
+        depth = reach;
     }
 
-    if (!tree.treeContains(node) || !(node->ccount > 0)) {
+    if (!view.expanded(node)) {
         return;
     }
 
-    MclTree::Nodes children;
-    for (const auto &c : node->children) {
-        if (tree.treeContains(c.get())) {
-            children.push_back(c.get());
-        }
-    }
-
+    SearchView::Nodes children;
+    view.children(node, children);
     int ccount = children.size();
     if (!(ccount > 0)) {
         return;
     }
 
-    const auto &center = pmap[node_];
+    const auto &center = pmap[node];
     double childrenWidth = nodeWidth * ccount + hMargin * (ccount - 1);
     double crx = center.x() - childrenWidth / 2;
     double cry = center.y() + nodeHeight / 2 + vMargin;
     QRectF rect(crx, cry, childrenWidth, nodeHeight);
     QPointF rcenter = rect.center();
-    MclTree::Nodes leftNodes;
-    MclTree::Nodes rightNodes;
+    std::vector<Node> leftNodes;
+    std::vector<Node> rightNodes;
     double ldelta = 0;
     double rdelta = 0;
 
     for (const auto &entry : rmap) {
         const auto &n = entry.first;
-        if (n->depth != node->depth) {
+        if (view.depth(n) != ndepth) {
             continue;
         }
 
@@ -172,14 +381,13 @@ void MclWidget::GeometryTraverse::operator()(const MclNode *node)
         }
     }
 
-    auto cfunc = [this](double delta, const std::unique_ptr<MclNode> &c) {
-        if (tree.treeContains(c.get())) {
-            pmap.at(c.get()).rx() += delta;
-        }
+    auto cfunc = [this](double delta, Node c) {
+        pmap.at(c).rx() += delta;
     };
+    SearchView::Nodes shifted;
 
     if (ldelta > 0) {
-        auto lcomp = [this](MclNode *n1, MclNode *n2) {
+        auto lcomp = [this](Node n1, Node n2) {
             return rmap.at(n1).x() > rmap.at(n2).x();
         };
         std::sort(leftNodes.begin(), leftNodes.end(), lcomp);
@@ -189,8 +397,9 @@ void MclWidget::GeometryTraverse::operator()(const MclNode *node)
             auto n = *it;
             auto r = rmap.at(n).translated(-ldelta, 0);
             rmap[n] = r;
-            const auto &c = n->children;
-            std::for_each(c.cbegin(), c.cend(), std::bind(cfunc, -ldelta, _1));
+            shifted.clear();
+            view.children(n, shifted);
+            std::for_each(shifted.cbegin(), shifted.cend(), std::bind(cfunc, -ldelta, _1));
 
             if (++it == leftNodes.cend()) {
                 break;
@@ -204,7 +413,7 @@ void MclWidget::GeometryTraverse::operator()(const MclNode *node)
     }
 
     if (rdelta > 0) {
-        auto rcomp = [this](MclNode *n1, MclNode *n2) {
+        auto rcomp = [this](Node n1, Node n2) {
             return rmap.at(n1).x() < rmap.at(n2).x();
         };
         std::sort(rightNodes.begin(), rightNodes.end(), rcomp);
@@ -214,8 +423,9 @@ void MclWidget::GeometryTraverse::operator()(const MclNode *node)
             auto n = *it;
             auto r = rmap.at(n).translated(rdelta, 0);
             rmap[n] = r;
-            const auto &c = n->children;
-            std::for_each(c.cbegin(), c.cend(), std::bind(cfunc, rdelta, _1));
+            shifted.clear();
+            view.children(n, shifted);
+            std::for_each(shifted.cbegin(), shifted.cend(), std::bind(cfunc, rdelta, _1));
 
             if (++it == rightNodes.cend()) {
                 break;
@@ -228,11 +438,11 @@ void MclWidget::GeometryTraverse::operator()(const MclNode *node)
         }
     }
 
-    rmap[node_] = rect;
+    rmap[node] = rect;
     double cx = rect.x() + nodeWidth / 2;
     double cy = rect.y() + nodeHeight / 2;
 
-    for (const auto &c : children) {
+    for (Node c : children) {
         pmap[c] = QPointF(cx, cy);
         cx += nodeWidth + hMargin;
     }
@@ -260,6 +470,7 @@ double MclWidget::GeometryTraverse::height() const
 
 void MclWidget::GeometryTraverse::translate(double dx, double dy)
 {
+    offset += QPointF(dx, dy);
     for (auto &entry : pmap) {
         entry.second.rx() += dx;
         entry.second.ry() += dy;
@@ -270,163 +481,621 @@ void MclWidget::GeometryTraverse::translate(double dx, double dy)
     }
 }
 
-MclNode *MclWidget::GeometryTraverse::nodeAt(double x, double y)
+void MclWidget::GeometryTraverse::index()
 {
-    using std::pow;
-
+    levels.clear();
     for (const auto &entry : pmap) {
-        const QPointF &c = entry.second;
-        double v = pow(2 * (x - c.x()) / nodeWidth, 2) +
-                   pow(2 * (y - c.y()) / nodeHeight, 2);
-        if (v <= 1) {
-            return const_cast<MclNode*>(entry.first);
+        std::size_t d = view.depth(entry.first);
+        if (levels.size() <= d) {
+            levels.resize(d + 1);
         }
+        levels[d].nodes.push_back(entry.first);
     }
 
-    return nullptr;
-}
-
-MclWidget::PaintTraverse::PaintTraverse(QPainter &p, const MclWidget *w)
-    : painter{p}, widget{w}, tree{w->tree}, pmap{w->gtraverse->pmap}
-{
+    std::size_t offset = 0;
+    for (auto &level : levels) {
+        level.offset = offset;
+        offset += level.nodes.size();
+        auto &nodes = level.nodes;
+        auto comp = [this](Node n1, Node n2) {
+            return pmap.at(n1).x() < pmap.at(n2).x();
+        };
+        std::sort(nodes.begin(), nodes.end(), comp);
+
+        level.xs.clear();
+        level.reach = 0;
+        for (const auto &n : nodes) {
+            const QPointF &c = pmap.at(n);
+            level.xs.push_back(c.x());
+            level.y = c.y();
+            Node parent = view.parent(n);
+            if (parent != nullptr) {
+                double reach = std::abs(c.x() - pmap.at(parent).x());
+                level.reach = std::max(level.reach, reach);
+            }
+        }
+    }
 }
 
-void MclWidget::PaintTraverse::operator()(const MclNode *node)
+MclWidget::Node MclWidget::GeometryTraverse::nodeAt(double x, double y) const
 {
-    if (!tree.treeContains(node)) {
-        return;
-    }
+    using std::pow;
 
-    MclNode *node_ = const_cast<MclNode*>(node);
-    const MclNode *hn = widget->hoverNode;
-    bool isDummyChildren = false;
+    for (const auto &level : levels) {
+        if (std::abs(y - level.y) > nodeHeight / 2) {
+            continue;
+        }
 
-    if (hn != nullptr && hn->children.size() > 0) {
-        for (const auto &c : hn->children) {
-            auto it = tree.uniq.find(c.get());
-            if (*it == node && node != c.get()) {
-                isDummyChildren = true;
-                break;
+        const auto &xs = level.xs;
+        auto first = std::lower_bound(xs.cbegin(), xs.cend(), x - nodeWidth / 2);
+        auto last = std::upper_bound(first, xs.cend(), x + nodeWidth / 2);
+        for (auto it = first; it != last; ++it) {
+            Node n = level.nodes[it - xs.cbegin()];
+            const QPointF &c = pmap.at(n);
+            double v = pow(2 * (x - c.x()) / nodeWidth, 2) +
+                       pow(2 * (y - c.y()) / nodeHeight, 2);
+            if (v <= 1) {
+                return n;
             }
         }
     }
 
-    const auto &path = widget->path;
-    QString color;
-    if (node == hn) {
-        color = "darkblue";
-    } else if (node == tree.current) {
-        color = "darkred";
-    } else if (isDummyChildren) {
-        color = "darkblue";
-    } else if (std::find(path.cbegin(), path.cend(), node_) != path.cend()) {
-        color = "green";
-    }
+    return nullptr;
+}
 
-    QPen ppen = painter.pen();
-    if (!color.isEmpty()) {
-        QPen pen = ppen;
-        pen.setColor(QColor(color));
-        painter.setPen(pen);
-    }
+std::vector<std::size_t>
+MclWidget::GeometryTraverse::indicesIn(const QRectF &rect, qreal tagWidth) const
+{
+    std::vector<std::size_t> indices;
+    double hpad = nodeBounds(QPointF(), tagWidth).width() / 2;
+    double vpad = nodeHeight / 2 + vMargin;
 
-    const auto &c = node->children;
-    QString rtag;
-    if (c.size() > 0) {
-        auto p = [this](const std::unique_ptr<MclNode> &c) {
-            return !tree.treeContains(c.get());
-        };
-        int dummyChildren = std::count_if(c.cbegin(), c.cend(), p);
-        if (dummyChildren > 0) {
-            QTextStream(&rtag) << "+" << dummyChildren;
+    for (const auto &level : levels) {
+        if (level.y + vpad < rect.top() || level.y - vpad > rect.bottom()) {
+            continue;
         }
-    }
 
-    paintNode(node, painter, pmap.at(node_), rtag);
-    if (!color.isEmpty()) {
-        painter.setPen(ppen);
-    }
+        const auto &xs = level.xs;
+        double pad = std::max(hpad, level.reach + hMargin / 2);
+        auto first = std::lower_bound(xs.cbegin(), xs.cend(), rect.left() - pad);
+        auto last = std::upper_bound(first, xs.cend(), rect.right() + pad);
+        for (auto it = first; it != last; ++it) {
+            std::size_t i = it - xs.cbegin();
+            Node n = level.nodes[i];
+            const QPointF &c = pmap.at(n);
+            bool visible = nodeBounds(c, tagWidth).intersects(rect);
+            Node parent = view.parent(n);
+            if (!visible && parent != nullptr) {
+                visible = edgeBounds(c, pmap.at(parent)).intersects(rect);
+            }
 
-    if (node->parent != nullptr) {
-        QString tag('A' + node->op);
-        paintEdge(painter, pmap.at(node_), pmap.at(node->parent), tag);
+            if (visible) {
+                indices.push_back(level.offset + i);
+            }
+        }
     }
+
+    return indices;
+}
+
+MclWidget::MclWidget(MclStrategy strategy, QWidget *parent)
+    : MclWidget(std::unique_ptr<SearchView>(
+                    new MclView(MclProblem{MclInstance()}, strategy,
+                                MclTree::recordHeader(MclInstance(), strategy))),
+                parent)
+{
 }
 
-MclWidget::MclWidget(QWidget *parent) : QWidget(parent)
+MclWidget::MclWidget(std::unique_ptr<SearchView> v, QWidget *parent)
+    : QAbstractScrollArea(parent), view_{std::move(v)}, glyphs{font()}
 {
-    setMouseTracking(true);
+    viewport()->setMouseTracking(true);
+    horizontalScrollBar()->setSingleStep(20);
+    verticalScrollBar()->setSingleStep(20);
+    connect(&replayWatcher, SIGNAL(finished()), this, SLOT(replayPrepared()));
 }
 
 MclWidget::~MclWidget()
 {
+    replayWatcher.waitForFinished();
     if (gtraverse != nullptr) {
         delete gtraverse;
     }
 }
 
+void MclWidget::ensureVisible(double x, double y, int xmargin, int ymargin)
+{
+    QScrollBar *hbar = horizontalScrollBar();
+    QScrollBar *vbar = verticalScrollBar();
+    int vw = viewport()->width();
+    int vh = viewport()->height();
+    x *= scale;
+    y *= scale;
+
+    if (x - xmargin < hbar->value()) {
+        hbar->setValue(std::floor(x - xmargin));
+    } else if (x + xmargin > hbar->value() + vw) {
+        hbar->setValue(std::ceil(x + xmargin - vw));
+    }
+
+    if (y - ymargin < vbar->value()) {
+        vbar->setValue(std::floor(y - ymargin));
+    } else if (y + ymargin > vbar->value() + vh) {
+        vbar->setValue(std::ceil(y + ymargin - vh));
+    }
+}
+
+const MclStats &MclWidget::stats() const
+{
+    return view_->stats();
+}
+
 void MclWidget::nextIteration()
 {
-    if (tree.next()) {
+    if (!replaying() && view_->next()) {
         updateTree();
     }
 }
 
 void MclWidget::previousIteration()
 {
-    if (tree.previous()) {
+    if (!replaying() && view_->previous()) {
         updateTree();
     }
 }
 
-void MclWidget::doGeometryTraverse()
+void MclWidget::setRecorder(SearchRecorder *recorder)
 {
-    if (gtraverse != nullptr) {
-        delete gtraverse;
+    view_->setRecorder(recorder);
+}
+
+bool MclWidget::replay(std::unique_ptr<SearchLog> log)
+{
+    MclInstance inst;
+    MclStrategy strategy;
+    if (!view_->startReplay(*log)) {
+        if (MclTree::fromRecordHeader(log->header, inst, strategy)) {
+            qCritical().nospace() << "The recording is of a " << inst.missionaries << "x"
+                                  << inst.cannibals << "b" << inst.boat << " "
+                                  << MclTree::strategyName(strategy) << " search";
+        } else {
+            qCritical() << "Not a recording of this search";
+        }
+        return false;
+    }
+
+    replayLog = std::move(log);
+    replayWatcher.setFuture(QtConcurrent::run([this]() { view_->prepareReplay(); }));
+    updateTree();
+    return true;
+}
+
+void MclWidget::replayPrepared()
+{
+    std::uint64_t divergent = view_->replayDivergent();
+    if (divergent > 0) {
+        qWarning() << divergent << "recorded steps could not be replayed";
     }
+    emit replayReady(qint64(replayLog->size()));
+}
 
-    gtraverse = new GeometryTraverse(tree);
-    tree.traverse(*gtraverse);
+void MclWidget::seekReplay(int position)
+{
+    if (!replaying() || replayWatcher.isRunning()) {
+        return;
+    }
+
+    view_->seekReplay(std::uint64_t(position));
+    updateTree();
+}
+
+void MclWidget::zoomIn()
+{
+    setScale(scale * zoomStep, viewport()->rect().center());
+}
+
+void MclWidget::zoomOut()
+{
+    setScale(scale / zoomStep, viewport()->rect().center());
+}
+
+void MclWidget::resetZoom()
+{
+    setScale(1.0, viewport()->rect().center());
+}
+
+MclWidget::TreeDelta MclWidget::diffGeometry(const GeometryTraverse &g)
+{
+    TreeDelta d;
+    layouts++;
+    for (const auto &entry : g.pmap) {
+        Node node = entry.first;
+        std::uint32_t id = view_->id(node);
+        if (id >= placements.size()) {
+            placements.resize(id + 1);
+        }
+
+        Placement &p = placements[id];
+        std::uint64_t key = view_->key(node);
+        if (p.seen != 0 && p.key != key) {
+            d.removed.push_back({id, p.key, p.position});
+            p.seen = 0;
+        }
+
+        if (p.seen == 0) {
+            d.added.push_back({node, entry.second, entry.second});
+        } else if (p.position != entry.second) {
+            d.moved.push_back({node, entry.second, p.position});
+        }
+        p = {key, entry.second, layouts};
+    }
+
+    for (std::uint32_t id = 0; id < placements.size(); id++) {
+        Placement &p = placements[id];
+        if (p.seen != 0 && p.seen != layouts) {
+            d.removed.push_back({id, p.key, p.position});
+            p.seen = 0;
+        }
+    }
+
+    while (!placements.empty() && placements.back().seen == 0) {
+        placements.pop_back();
+    }
+
+    d.current = view_->current();
+    return d;
+}
+
+void MclWidget::doGeometryTraverse()
+{
+    MCL_TRACE_SPAN("MclWidget::doGeometryTraverse");
+    delete gtraverse;
+    gtraverse = new GeometryTraverse(*view_);
+    view_->traverse(std::ref(*gtraverse));
+    delta = diffGeometry(*gtraverse);
     updateGeometry_();
+
+    // The layout is diffed before layoutTree() centres it, so only the
+    // entries are moved to canvas coordinates here.
+    const QPointF &offset = gtraverse->offset;
+    for (auto &e : delta.added) {
+        e.position += offset;
+        e.previous = e.position;
+    }
+    for (auto &e : delta.moved) {
+        e.position += offset;
+        e.previous += layoutOffset;
+    }
+    for (auto &e : delta.removed) {
+        e.previous += layoutOffset;
+    }
+    delta.translation = offset - layoutOffset;
+    delta.currentPosition = gtraverse->pmap.at(view_->current());
+    layoutOffset = offset;
 }
 
 void MclWidget::updateGeometry_()
 {
-    double minWidth = 0;
-    double minHeight = 0;
-    
-    if (parentWidget() != nullptr) {
-        QSize ps = parentWidget()->size();
-        minWidth = ps.width();
-        minHeight = ps.height();
-    }
+    MCL_TRACE_SPAN("MclWidget::updateGeometry_");
+    MCL_STAT_TIMER(view_->stats(), Layout);
+    canvasSize = layoutTree(*gtraverse, viewport()->size());
+    updateScrollBars();
+}
 
-    double tw = gtraverse->width();
-    double th = gtraverse->height(); double w = std::max(minWidth, tw + 2 * treeHMargin);
-    double h = std::max(minHeight, th + 2 * treeVMargin);
-    double treeRectLeft = (w - tw) / 2;
-    double dx = treeRectLeft - gtraverse->leftmost.left();
-    double dy = treeVMargin + nodeHeight / 2;
-    gtraverse->translate(dx, dy);
-    setFixedSize(w, h);
+void MclWidget::updateScrollBars()
+{
+    QSize vs = viewport()->size();
+    QSize ss = screenRect().size();
+    QScrollBar *hbar = horizontalScrollBar();
+    QScrollBar *vbar = verticalScrollBar();
+    hbar->setRange(0, std::max(0, ss.width() - vs.width()));
+    hbar->setPageStep(vs.width());
+    vbar->setRange(0, std::max(0, ss.height() - vs.height()));
+    vbar->setPageStep(vs.height());
 }
 
 void MclWidget::updateTree()
 {
     doGeometryTraverse();
-    path = tree.pathBetween(tree.root, tree.current);
-    repaint();
+    QPoint vpos = viewport()->mapFromGlobal(QCursor::pos());
+    QPointF pos = toCanvas(vpos);
+    bool under = viewport()->underMouse();
+    setHoverNode(under ? gtraverse->nodeAt(pos.x(), pos.y()) : nullptr);
+    path = view_->pathToCurrent();
+    displayList = buildDisplayList(*gtraverse, path, glyphs);
+    buildClusters();
+    tiles.invalidate();
+    viewport()->update();
     emit treeUpdate(*gtraverse);
+    emit treeChanged(delta);
+}
+
+void MclWidget::buildClusters()
+{
+    std::unordered_set<Node> onPath(path.cbegin(), path.cend());
+    std::unordered_map<Node, std::size_t> clusterOf;
+    clusters.clear();
+    pathItems.clear();
+
+    for (std::size_t i = 0; i < displayList.size(); i++) {
+        const DisplayItem &item = displayList[i];
+        if (onPath.count(item.node) > 0) {
+            pathItems.push_back(i);
+            continue;
+        }
+
+        std::size_t ci;
+        if (onPath.count(item.parent) > 0) {
+            ci = clusters.size();
+            clusters.push_back(Cluster{QRectF(), 0, i});
+        } else {
+            ci = clusterOf.at(item.parent);
+        }
+
+        clusterOf[item.node] = ci;
+        QRectF rect(0, 0, nodeWidth, nodeHeight);
+        rect.moveCenter(item.center);
+        Cluster &cluster = clusters[ci];
+        cluster.bounds = cluster.bounds.isNull() ? rect : cluster.bounds.united(rect);
+        cluster.count++;
+    }
+}
+
+void MclWidget::setScale(double s, const QPoint &anchor)
+{
+    s = std::min(maxScale, std::max(minScale, s));
+    if (s == scale) {
+        return;
+    }
+
+    QPointF canvasAnchor = toCanvas(anchor);
+    scale = s;
+    updateScrollBars();
+
+    QPointF screenAnchor = canvasAnchor * scale;
+    QPoint margin = viewOrigin() + canvasOffset();
+    horizontalScrollBar()->setValue(std::round(screenAnchor.x() + margin.x() - anchor.x()));
+    verticalScrollBar()->setValue(std::round(screenAnchor.y() + margin.y() - anchor.y()));
+    tiles.invalidate();
+    viewport()->update();
+}
+
+QPoint MclWidget::canvasOffset() const
+{
+    return QPoint(horizontalScrollBar()->value(), verticalScrollBar()->value());
+}
+
+QRect MclWidget::screenRect() const
+{
+    return QRect(0, 0, std::ceil(canvasSize.width() * scale),
+                 std::ceil(canvasSize.height() * scale));
+}
+
+QPoint MclWidget::viewOrigin() const
+{
+    QSize vs = viewport()->size();
+    QSize ss = screenRect().size();
+    QPoint margin(std::max(0, (vs.width() - ss.width()) / 2),
+                  std::max(0, (vs.height() - ss.height()) / 2));
+    return margin - canvasOffset();
+}
+
+QPointF MclWidget::toCanvas(const QPoint &pos) const
+{
+    return QPointF(pos - viewOrigin()) / scale;
+}
+
+void MclWidget::invalidateCanvas(const QRectF &rect)
+{
+    QRectF srect(rect.topLeft() * scale, rect.size() * scale);
+    QRect r = srect.toAlignedRect();
+    tiles.invalidate(r);
+    viewport()->update(r.translated(viewOrigin()));
+}
+
+SearchView::Nodes MclWidget::highlightedBy(Node node) const
+{
+    return node != nullptr ? view_->repeatedBy(node) : SearchView::Nodes();
+}
+
+void MclWidget::setHoverNode(Node node)
+{
+    hoverNode = node;
+    hoverTargets = highlightedBy(node);
+}
+
+void MclWidget::updateHover(Node node)
+{
+    if (node == nullptr) {
+        return;
+    }
+
+    const auto &pmap = gtraverse->pmap;
+    auto it = pmap.find(node);
+    if (it == pmap.end()) {
+        return;
+    }
+
+    invalidateCanvas(nodeBounds(it->second, glyphs.tagWidth));
+    for (const auto &n : highlightedBy(node)) {
+        invalidateCanvas(nodeBounds(pmap.at(n), glyphs.tagWidth));
+    }
+}
+
+MclWidget::DisplayItem::Color MclWidget::itemColor(const DisplayItem &item) const
+{
+    if (item.node == hoverNode) {
+        return DisplayItem::Hover;
+    } else if (item.color == DisplayItem::Current) {
+        return DisplayItem::Current;
+    }
+
+    const auto &h = hoverTargets;
+    if (std::find(h.cbegin(), h.cend(), item.node) != h.cend()) {
+        return DisplayItem::Hover;
+    }
+
+    return item.color;
+}
+
+void MclWidget::prepareSprites(const QRectF &rect)
+{
+    if (scale < lodScale) {
+        return;
+    }
+
+    for (std::size_t i : gtraverse->indicesIn(rect, glyphs.tagWidth)) {
+        const DisplayItem &item = displayList[i];
+        glyphs.sprite(item, itemColor(item));
+    }
+}
+
+QImage MclWidget::renderTile(const QRect &rect) const
+{
+    MCL_TRACE_SPAN("MclWidget::renderTile");
+    qreal dpr = glyphs.dpr;
+    QImage image(rect.size() * dpr, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(dpr);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, scale != 1.0);
+    painter.translate(-rect.topLeft());
+    painter.scale(scale, scale);
+    painter.setPen(glyphs.pen);
+    QRectF crect(QPointF(rect.topLeft()) / scale, QSizeF(rect.size()) / scale);
+
+    if (scale < lodScale) {
+        renderOverview(painter, crect);
+    } else {
+        renderDetail(painter, crect);
+    }
+
+    return image;
+}
+
+void MclWidget::renderDetail(QPainter &painter, const QRectF &rect) const
+{
+    QSizeF ssize = glyphs.spriteSize();
+    QPointF origin(ssize.width() / 2, ssize.height() / 2);
+
+    for (std::size_t i : gtraverse->indicesIn(rect, glyphs.tagWidth)) {
+        const DisplayItem &item = displayList[i];
+        auto color = itemColor(item);
+        const QImage *sprite = glyphs.findSprite(item, color);
+        if (sprite != nullptr) {
+            painter.drawImage(item.center - origin, *sprite);
+        }
+
+        paintEdge(painter, item, glyphs);
+    }
+}
+
+void MclWidget::renderOverview(QPainter &painter, const QRectF &rect) const
+{
+    QPen pen = painter.pen();
+    QColor fill = pen.color();
+
+    for (const auto &cluster : clusters) {
+        const DisplayItem &root = displayList[cluster.root];
+        QRectF bounds = cluster.bounds.united(edgeBounds(root.edge.p1(), root.edge.p2()));
+        if (!bounds.intersects(rect)) {
+            continue;
+        }
+
+        painter.drawLine(root.edge);
+
+        double area = cluster.bounds.width() * cluster.bounds.height();
+        double density = cluster.count * nodeWidth * nodeHeight / area;
+        fill.setAlphaF(0.15 + 0.6 * std::min(1.0, density));
+        painter.fillRect(cluster.bounds, fill);
+
+        QRectF label = painter.transform().mapRect(cluster.bounds);
+        painter.save();
+        painter.resetTransform();
+        painter.setFont(glyphs.tagFont);
+        painter.drawText(label, Qt::AlignCenter, QString::number(cluster.count));
+        painter.restore();
+    }
+
+    for (std::size_t i : pathItems) {
+        const DisplayItem &item = displayList[i];
+        QColor color = displayColor(itemColor(item));
+        QPen cpen = pen;
+        if (color.isValid()) {
+            cpen.setColor(color);
+        }
+
+        QRectF nrect(0, 0, nodeWidth, nodeHeight);
+        nrect.moveCenter(item.center);
+        if (item.parent != nullptr) {
+            painter.setPen(pen);
+            painter.drawLine(item.edge);
+        }
+
+        painter.setPen(cpen);
+        painter.drawEllipse(nrect);
+    }
+
+    painter.setPen(pen);
 }
 
 void MclWidget::paintEvent(QPaintEvent *ev)
 {
-    QPainter painter(this);
+    MCL_TRACE_SPAN("MclWidget::paintEvent");
+    MCL_STAT_TIMER(view_->stats(), Paint);
+    QPainter painter(viewport());
     QPen pen(painter.pen());
     pen.setWidth(2);
-    painter.setPen(pen);
-    PaintTraverse ptraverse(painter, this);
-    tree.traverse(ptraverse);
+    if (glyphs.prepare(pen, devicePixelRatioF())) {
+        tiles.invalidate();
+    }
+
+    struct Tile {
+        QRect rect;
+        QImage image;
+        bool cached;
+    };
+
+    QPoint origin = viewOrigin();
+    QRect exposed = ev->rect().translated(-origin).intersected(screenRect());
+    if (exposed.isEmpty()) {
+        return;
+    }
+
+    int ts = tiles.tileSize();
+    std::vector<Tile> visible;
+    bool pending = false;
+
+    for (int ty = exposed.top() / ts; ty <= exposed.bottom() / ts; ty++) {
+        for (int tx = exposed.left() / ts; tx <= exposed.right() / ts; tx++) {
+            const QImage *image = tiles.find(tx, ty);
+            Tile t{tiles.tileRect(tx, ty), QImage(), image != nullptr};
+            if (t.cached) {
+                t.image = *image;
+            } else {
+                QRectF r(QPointF(t.rect.topLeft()) / scale, QSizeF(t.rect.size()) / scale);
+                prepareSprites(r);
+                pending = true;
+            }
+            visible.push_back(t);
+        }
+    }
+
+    if (pending) {
+        QtConcurrent::blockingMap(visible, [this](Tile &t) {
+            if (!t.cached) {
+                t.image = renderTile(t.rect);
+            }
+        });
+    }
+
+    for (const auto &t : visible) {
+        if (!t.cached) {
+            tiles.insert(t.rect.x() / ts, t.rect.y() / ts, t.image);
+        }
+        painter.drawImage(t.rect.topLeft() + origin, t.image);
+    }
 }
 
 void MclWidget::resizeEvent(QResizeEvent *ev)
@@ -434,11 +1103,30 @@ void MclWidget::resizeEvent(QResizeEvent *ev)
     updateTree();
 }
 
+void MclWidget::scrollContentsBy(int dx, int dy)
+{
+    viewport()->update();
+}
+
 void MclWidget::mouseMoveEvent(QMouseEvent *ev)
 {
-    const MclNode *prev = hoverNode;
-    hoverNode = gtraverse->nodeAt(ev->x(), ev->y());
+    QPointF pos = toCanvas(ev->pos());
+    Node prev = hoverNode;
+    setHoverNode(gtraverse->nodeAt(pos.x(), pos.y()));
     if (hoverNode != prev) {
-        repaint();
+        updateHover(prev);
+        updateHover(hoverNode);
+    }
+}
+
+void MclWidget::wheelEvent(QWheelEvent *ev)
+{
+    if (!(ev->modifiers() & Qt::ControlModifier)) {
+        QAbstractScrollArea::wheelEvent(ev);
+        return;
     }
+
+    double factor = std::pow(zoomStep, ev->angleDelta().y() / 120.0);
+    setScale(scale * factor, ev->position().toPoint());
+    ev->accept();
 }
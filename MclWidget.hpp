@@ -3,72 +3,250 @@
 #define MCLWIDGET_HPP
 
 #include <unordered_map>
-#include <QWidget>
+#include <unordered_set>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <QAbstractScrollArea>
+#include <QFutureWatcher>
+#include <QHash>
 #include <QPainter>
+#include <QImage>
 #include "mcl.hpp"
+#include "searchview.hpp"
+#include "TileCache.hpp"
 
-class MclWidget : public QWidget {
+class MclWidget : public QAbstractScrollArea {
     Q_OBJECT
+    friend class TreeExporter;
 public:
-    struct GeometryTraverse : MclTree::SequentialTraverse {
-        explicit GeometryTraverse(const MclTree &t);
-        ~GeometryTraverse() { }
-        void operator()(const MclNode *node) override;
+    using Node = SearchView::Node;
+
+    struct GeometryTraverse {
+        explicit GeometryTraverse(const SearchView &v);
+        void operator()(Node node);
         double width() const;
         double height() const;
         void translate(double dx, double dy);
-        MclNode *nodeAt(double x, double y);
+        void index();
+        Node nodeAt(double x, double y) const;
+        std::vector<std::size_t> indicesIn(const QRectF &rect, qreal tagWidth) const;
+
+        struct Level {
+            std::vector<Node> nodes;
+            std::vector<double> xs;
+            std::size_t offset = 0;
+            double y = 0;
+            double reach = 0;
+        };
 
-        const MclTree &tree;
-        using PMap = std::unordered_map<MclNode*, QPointF>;
-        using RMap = std::unordered_map<MclNode*, QRectF>;
+        const SearchView &view;
+        using PMap = std::unordered_map<Node, QPointF>;
+        using RMap = std::unordered_map<Node, QRectF>;
         PMap pmap;
         RMap rmap;
+        std::vector<Level> levels;
         int depth;
         QRectF leftmost;
         QRectF rightmost;
+        QPointF offset;
+    };
+
+    struct DisplayItem {
+        enum Color { Plain, Current, Path, Hover };
+
+        Node node = nullptr;
+        Node parent = nullptr;
+        QString label;
+        int priority = 0;
+        int op = -1;
+        QPointF center;
+        Color color = Plain;
+        int dummyChildren = 0;
+        QLineF edge;
+        QPointF edgeTagPos;
+    };
+
+    // moved only lists nodes whose place in the layout changed; centring the
+    // layout on the canvas shifts every node by translation on top of that.
+    // Removed nodes are already freed, so they go by snapshot id and key.
+    struct TreeDelta {
+        struct Entry {
+            Node node;
+            QPointF position;
+            QPointF previous;
+        };
+
+        struct Removal {
+            std::uint32_t id;
+            std::uint64_t key;
+            QPointF previous;
+        };
+
+        std::vector<Entry> added;
+        std::vector<Removal> removed;
+        std::vector<Entry> moved;
+        QPointF translation;
+        Node current = nullptr;
+        QPointF currentPosition;
+    };
+
+    // Sprites go by what they show, so nodes with the same label share one.
+    struct SpriteKey {
+        bool operator==(const SpriteKey &other) const
+        {
+            return label == other.label && priority == other.priority &&
+                   dummyChildren == other.dummyChildren && color == other.color;
+        }
+
+        QString label;
+        int priority;
+        int dummyChildren;
+        DisplayItem::Color color;
+    };
+
+    struct SpriteHash {
+        std::size_t operator()(const SpriteKey &key) const
+        {
+            return qHash(key.label) ^ (uint(key.priority) * 31u) ^
+                   (uint(key.dummyChildren) << 8) ^ (uint(key.color) << 24);
+        }
+    };
+
+    // Op tags are measured, and drawn once prepared, the first time an edge
+    // needs them; only the GUI thread may do that.
+    struct Glyphs {
+        explicit Glyphs(const QFont &f = QFont());
+        bool prepare(const QPen &p, qreal d);
+        QSizeF opSize(int op);
+        const QImage &sprite(const DisplayItem &item, DisplayItem::Color color);
+        const QImage *findSprite(const DisplayItem &item, DisplayItem::Color color) const;
+        QSizeF spriteSize() const;
+
+        QFont font;
+        QFont tagFont;
+        qreal tagWidth;
+        QPen pen;
+        qreal dpr = 0;
+        std::vector<QSizeF> opSizes;
+        std::vector<QImage> opSprites;
+        std::unordered_map<SpriteKey, QImage, SpriteHash> sprites;
+    private:
+        QImage opSprite(int op) const;
     };
 
-    explicit MclWidget(QWidget *parent = nullptr);
+    static QSizeF layoutTree(GeometryTraverse &g, const QSizeF &minSize = QSizeF());
+    static DisplayItem makeDisplayItem(const GeometryTraverse &g, Node node,
+                                       const std::unordered_set<Node> &onPath,
+                                       Glyphs &glyphs);
+    static std::vector<DisplayItem> buildDisplayList(const GeometryTraverse &g,
+                                                     const SearchView::Nodes &path,
+                                                     Glyphs &glyphs);
+    static QColor displayColor(DisplayItem::Color color);
+    static QString opTag(int op);
+    static void paintNode(QPainter &painter, const DisplayItem &item,
+                          const QPointF &center, const Glyphs &glyphs);
+    static void paintEdge(QPainter &painter, const DisplayItem &item,
+                          const Glyphs &glyphs);
+
+    explicit MclWidget(MclStrategy strategy = MclStrategy::Greedy,
+                       QWidget *parent = nullptr);
+    explicit MclWidget(std::unique_ptr<SearchView> v, QWidget *parent = nullptr);
     ~MclWidget();
+    void ensureVisible(double x, double y, int xmargin = 50, int ymargin = 50);
+    const SearchView &view() const { return *view_; }
+    const MclStats &stats() const;
+    void setRecorder(SearchRecorder *recorder);
+    bool replay(std::unique_ptr<SearchLog> log);
+    bool replaying() const { return replayLog != nullptr; }
 signals:
     void treeUpdate(const MclWidget::GeometryTraverse &g);
+    void treeChanged(const MclWidget::TreeDelta &delta);
+    void replayReady(qint64 events);
 public slots:
     void nextIteration();
     void previousIteration();
+    void seekReplay(int position);
+    void zoomIn();
+    void zoomOut();
+    void resetZoom();
 private:
     static constexpr double const nodeWidth = 80.0;
     static constexpr double const nodeHeight = 40.0;
     static constexpr double const hMargin = 60.0;
     static constexpr double const vMargin = 40.0;
+    static constexpr double const tagGap = 5.0;
     static constexpr double const treeHMargin = 50;
     static constexpr double const treeVMargin = 50;
+    static constexpr double const minScale = 0.02;
+    static constexpr double const maxScale = 4.0;
+    static constexpr double const lodScale = 0.5;
+    static constexpr double const zoomStep = 1.25;
+
+    struct Placement {
+        std::uint64_t key;
+        QPointF position;
+        std::uint64_t seen = 0;
+    };
 
-    static void paintNode(const MclNode *node, QPainter &painter,
-                          const QPointF &center, const QString &rtag = QString());
-    static void paintEdge(QPainter &painter, const QPointF &c1,
-                          const QPointF &c2, const QString &tag = QString());
-
-    struct PaintTraverse : MclTree::SequentialTraverse {
-        explicit PaintTraverse(QPainter &p, const MclWidget *w);
-        void operator()(const MclNode *node) override;
-        QPainter &painter;
-        const MclWidget *widget;
-        const MclTree &tree;
-        const GeometryTraverse::PMap &pmap;
+    struct Cluster {
+        QRectF bounds;
+        int count;
+        std::size_t root;
     };
 
+    static QRectF nodeBounds(const QPointF &center, qreal tagWidth);
+    static QRectF edgeBounds(const QPointF &c1, const QPointF &c2);
+    static QLineF edgeLine(const QPointF &c1, const QPointF &c2);
+    static QRectF edgeTagRect(const QLineF &line, const QSizeF &size);
+
+    TreeDelta diffGeometry(const GeometryTraverse &g);
     void doGeometryTraverse();
     void updateGeometry_();
+    void updateScrollBars();
     void updateTree();
+    void buildClusters();
+    void setScale(double s, const QPoint &anchor);
+    QPoint canvasOffset() const;
+    QRect screenRect() const;
+    QPoint viewOrigin() const;
+    QPointF toCanvas(const QPoint &pos) const;
+    void invalidateCanvas(const QRectF &rect);
+    SearchView::Nodes highlightedBy(Node node) const;
+    void setHoverNode(Node node);
+    void updateHover(Node node);
+    DisplayItem::Color itemColor(const DisplayItem &item) const;
+    void prepareSprites(const QRectF &rect);
+    QImage renderTile(const QRect &rect) const;
+    void renderDetail(QPainter &painter, const QRectF &rect) const;
+    void renderOverview(QPainter &painter, const QRectF &rect) const;
+private slots:
+    void replayPrepared();
+private:
     GeometryTraverse *gtraverse = nullptr;
-    MclTree tree;
-    MclTree::Nodes path;
-    const MclNode *hoverNode = nullptr;
+    TreeDelta delta;
+    std::vector<Placement> placements;
+    std::uint64_t layouts = 0;
+    QPointF layoutOffset;
+    std::unique_ptr<SearchView> view_;
+    SearchView::Nodes path;
+    std::vector<DisplayItem> displayList;
+    std::vector<Cluster> clusters;
+    std::vector<std::size_t> pathItems;
+    Node hoverNode = nullptr;
+    SearchView::Nodes hoverTargets;
+    Glyphs glyphs;
+    TileCache tiles;
+    std::unique_ptr<SearchLog> replayLog;
+    QFutureWatcher<void> replayWatcher;
+    QSizeF canvasSize;
+    double scale = 1.0;
 protected:
     void paintEvent(QPaintEvent *ev) override;
     void resizeEvent(QResizeEvent *ev) override;
+    void scrollContentsBy(int dx, int dy) override;
     void mouseMoveEvent(QMouseEvent *ev) override;
+    void wheelEvent(QWheelEvent *ev) override;
 };
 
 #endif
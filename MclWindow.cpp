@@ -2,20 +2,29 @@
 #include <QtDebug>
 #include <QHBoxLayout>
 #include <QLabel>
+#include <algorithm>
+#include <climits>
 #include "LabelRow.hpp"
+#include "FormulaCache.hpp"
+#include "StatsPanel.hpp"
 #include "mcl.hpp"
 
-MclWindow::MclWindow(QWidget *parent) : QWidget(parent)
+MclWindow::MclWindow(MclStrategy s, QWidget *parent)
+    : QWidget(parent), strategy{s}
 {
     initWindow();
 }
 
-void MclWindow::mclUpdated(const MclWidget::GeometryTraverse &g)
+void MclWindow::mclUpdated(const MclWidget::TreeDelta &delta)
 {
-    const QPointF &cc = g.pmap.at(g.tree.current);
-    mclScroll->ensureVisible(cc.x(), cc.y());
-    nextItButton->setDisabled(MclTree::isTarget(g.tree.current));
-    prevItButton->setDisabled(g.tree.current == g.tree.root);
+    const QPointF &cc = delta.currentPosition;
+    mcl->ensureVisible(cc.x(), cc.y());
+    if (mcl->replaying()) {
+        return;
+    }
+
+    nextItButton->setDisabled(mcl->view().isTarget(delta.current));
+    prevItButton->setDisabled(mcl->view().parent(delta.current) == nullptr);
 }
  
 void MclWindow::initWindow()
@@ -39,51 +48,167 @@ void MclWindow::addWidgets()
     QHBoxLayout *hbox = new QHBoxLayout();
     nextItButton = new QPushButton("Siguiente ➡️");
     prevItButton = new QPushButton("⬅️ Anterior");
+    zoomOutButton = new QPushButton("Alejar");
+    zoomInButton = new QPushButton("Acercar");
+    zoomResetButton = new QPushButton("Tamaño real");
     nextItButton->setFocusPolicy(Qt::ClickFocus);
     prevItButton->setFocusPolicy(Qt::ClickFocus);
+    zoomOutButton->setFocusPolicy(Qt::ClickFocus);
+    zoomInButton->setFocusPolicy(Qt::ClickFocus);
+    zoomResetButton->setFocusPolicy(Qt::ClickFocus);
     hbox->addWidget(prevItButton);
     hbox->addWidget(nextItButton);
+    hbox->addWidget(zoomOutButton);
+    hbox->addWidget(zoomInButton);
+    hbox->addWidget(zoomResetButton);
     rightLayout->addLayout(hbox);
+    addReplayWidgets(rightLayout);
 
-    mclScroll = new QScrollArea();
-    mcl = new MclWidget();
-    mclScroll->setWidget(mcl);
-    rightLayout->addWidget(mclScroll, 1);
+    mcl = new MclWidget(strategy);
+    rightLayout->addWidget(mcl, 1);
+    if (MclStats::enabled) {
+        mainBox->addWidget(new StatsPanel(mcl->stats()));
+    }
     mainBox->addLayout(rightLayout);
 }
 
+void MclWindow::addReplayWidgets(QVBoxLayout *layout)
+{
+    replayBar = new QWidget();
+    QHBoxLayout *hbox = new QHBoxLayout();
+    hbox->setContentsMargins(0, 0, 0, 0);
+    playButton = new QPushButton("Reproducir");
+    replaySlider = new QSlider(Qt::Horizontal);
+    speedBox = new QSpinBox();
+    positionLabel = new QLabel();
+    playButton->setFocusPolicy(Qt::ClickFocus);
+    speedBox->setRange(1, 100000000);
+    speedBox->setValue(20);
+    speedBox->setSuffix(" eventos/s");
+    hbox->addWidget(playButton);
+    hbox->addWidget(replaySlider, 1);
+    hbox->addWidget(speedBox);
+    hbox->addWidget(positionLabel);
+    replayBar->setLayout(hbox);
+    replayBar->hide();
+    layout->addWidget(replayBar);
+    playTimer.setInterval(30);
+}
+
+void MclWindow::setRecorder(SearchRecorder *recorder)
+{
+    mcl->setRecorder(recorder);
+}
+
+bool MclWindow::replay(std::unique_ptr<SearchLog> log)
+{
+    if (!mcl->replay(std::move(log))) {
+        return false;
+    }
+
+    nextItButton->setDisabled(true);
+    prevItButton->setDisabled(true);
+    replayBar->setDisabled(true);
+    positionLabel->setText("Preparando...");
+    replayBar->show();
+    return true;
+}
+
+void MclWindow::replayReady(qint64 events)
+{
+    replaySlider->setRange(0, int(std::min<qint64>(events, INT_MAX)));
+    replaySlider->setValue(0);
+    replayMoved(0);
+    replayBar->setEnabled(true);
+}
+
+void MclWindow::replayMoved(int position)
+{
+    mcl->seekReplay(position);
+    positionLabel->setText(QString("%1 / %2").arg(position).arg(replaySlider->maximum()));
+}
+
+void MclWindow::togglePlayback()
+{
+    if (playTimer.isActive()) {
+        playTimer.stop();
+        playButton->setText("Reproducir");
+        return;
+    }
+
+    if (replaySlider->value() == replaySlider->maximum()) {
+        replaySlider->setValue(0);
+    }
+    playPosition = replaySlider->value();
+    playClock.start();
+    playTimer.start();
+    playButton->setText("Pausa");
+}
+
+void MclWindow::playbackTick()
+{
+    playPosition += speedBox->value() * (playClock.restart() / 1000.0);
+    int position = int(std::min<double>(playPosition, replaySlider->maximum()));
+    replaySlider->setValue(position);
+    if (position == replaySlider->maximum()) {
+        togglePlayback();
+    }
+}
+
 void MclWindow::addInfoWidgets()
 {
+    infoPanel = new QWidget();
+    infoPanel->installEventFilter(this);
+    mainBox->addWidget(infoPanel);
+}
+
+bool MclWindow::eventFilter(QObject *obj, QEvent *ev)
+{
+    if (obj == infoPanel && ev->type() == QEvent::Show &&
+        infoPanel->layout() == nullptr) {
+        QMetaObject::invokeMethod(this, "loadInfoWidgets", Qt::QueuedConnection);
+    }
+
+    return QWidget::eventFilter(obj, ev);
+}
+
+void MclWindow::loadInfoWidgets()
+{
+    if (infoPanel->layout() != nullptr) {
+        return;
+    }
+
     QVBoxLayout *infoLayout = new QVBoxLayout();
+    infoLayout->setContentsMargins(0, 0, 0, 0);
     infoLayout->setSpacing(0);
 
     infoLayout->addWidget(new LabelRow({
         "Espacio de estados:",
-        QVariant::fromValue(new QSvgWidget("latex/latex1.svg"))
+        QVariant::fromValue(Formula{"latex1"})
     }), 0, Qt::AlignHCenter);
 
     infoLayout->addWidget(new LabelRow({
         "Estado inicial:",
-        QVariant::fromValue(new QSvgWidget("latex/latex2.svg"))
+        QVariant::fromValue(Formula{"latex2"})
     }), 0, Qt::AlignHCenter);
 
     infoLayout->addWidget(new LabelRow({
         "Estado objetivo:",
-        QVariant::fromValue(new QSvgWidget("latex/latex3.svg"))
+        QVariant::fromValue(Formula{"latex3"})
     }), 0, Qt::AlignHCenter);
 
     infoLayout->addWidget(new LabelRow({
-        QVariant::fromValue(new QSvgWidget("latex/latex4.svg")),
+        QVariant::fromValue(Formula{"latex4"}),
         ": Cantidad de misioneros al lado izquierdo del río",
     }), 0, Qt::AlignHCenter);
 
     infoLayout->addWidget(new LabelRow({
-        QVariant::fromValue(new QSvgWidget("latex/latex5.svg")),
+        QVariant::fromValue(Formula{"latex5"}),
         ": Cantidad de caníbales al lado izquierdo del río",
     }), 0, Qt::AlignHCenter);
 
     infoLayout->addWidget(new LabelRow({
-        QVariant::fromValue(new QSvgWidget("latex/latex6.svg")),
+        QVariant::fromValue(Formula{"latex6"}),
         ": Posición de la lancha",
     }), 0, Qt::AlignHCenter);
 
@@ -92,47 +217,48 @@ void MclWindow::addInfoWidgets()
     infoLayout->addSpacing(10);
 
     infoLayout->addWidget(new LabelRow({
-        QVariant::fromValue(new QSvgWidget("latex/latex7.svg"))
+        QVariant::fromValue(Formula{"latex7"})
     }), 0, Qt::AlignHCenter);
 
     infoLayout->addWidget(new LabelRow({
-        QVariant::fromValue(new QSvgWidget("latex/latex8.svg"))
+        QVariant::fromValue(Formula{"latex8"})
     }), 0, Qt::AlignHCenter);
 
     infoLayout->addWidget(new LabelRow({
-        QVariant::fromValue(new QSvgWidget("latex/latex9.svg"))
+        QVariant::fromValue(Formula{"latex9"})
     }), 0, Qt::AlignHCenter);
 
     infoLayout->addWidget(new LabelRow({
-        QVariant::fromValue(new QSvgWidget("latex/latex10.svg"))
+        QVariant::fromValue(Formula{"latex10"})
     }), 0, Qt::AlignHCenter);
 
     infoLayout->addWidget(new LabelRow({
-        QVariant::fromValue(new QSvgWidget("latex/latex11.svg"))
+        QVariant::fromValue(Formula{"latex11"})
     }), 0, Qt::AlignHCenter);
 
     infoLayout->addWidget(new LabelRow({
-        QVariant::fromValue(new QSvgWidget("latex/latex12.svg"))
+        QVariant::fromValue(Formula{"latex12"})
     }), 0, Qt::AlignHCenter);
 
     infoLayout->addWidget(new LabelRow({
-        QVariant::fromValue(new QSvgWidget("latex/latex13.svg"))
+        QVariant::fromValue(Formula{"latex13"})
     }), 0, Qt::AlignHCenter);
 
     infoLayout->addWidget(new LabelRow({
-        QVariant::fromValue(new QSvgWidget("latex/latex14.svg"))
+        QVariant::fromValue(Formula{"latex14"})
     }), 0, Qt::AlignHCenter);
 
     infoLayout->addWidget(new LabelRow({
-        QVariant::fromValue(new QSvgWidget("latex/latex15.svg"))
+        QVariant::fromValue(Formula{"latex15"})
     }), 0, Qt::AlignHCenter);
 
     infoLayout->addWidget(new LabelRow({
-        QVariant::fromValue(new QSvgWidget("latex/latex16.svg"))
+        QVariant::fromValue(Formula{"latex16"})
     }), 0, Qt::AlignHCenter);
 
     infoLayout->addStretch();
-    mainBox->addLayout(infoLayout);
+    infoPanel->setLayout(infoLayout);
+    emit infoWidgetsLoaded();
 }
 
 void MclWindow::initSignals()
@@ -141,6 +267,13 @@ void MclWindow::initSignals()
             SLOT(nextIteration()));
     connect(prevItButton, SIGNAL(clicked()), mcl,
             SLOT(previousIteration()));
-    connect(mcl, SIGNAL(treeUpdate(const MclWidget::GeometryTraverse&)),
-            this, SLOT(mclUpdated(const MclWidget::GeometryTraverse&)));
+    connect(zoomOutButton, SIGNAL(clicked()), mcl, SLOT(zoomOut()));
+    connect(zoomInButton, SIGNAL(clicked()), mcl, SLOT(zoomIn()));
+    connect(zoomResetButton, SIGNAL(clicked()), mcl, SLOT(resetZoom()));
+    connect(mcl, SIGNAL(treeChanged(const MclWidget::TreeDelta&)),
+            this, SLOT(mclUpdated(const MclWidget::TreeDelta&)));
+    connect(mcl, SIGNAL(replayReady(qint64)), this, SLOT(replayReady(qint64)));
+    connect(replaySlider, SIGNAL(valueChanged(int)), this, SLOT(replayMoved(int)));
+    connect(playButton, SIGNAL(clicked()), this, SLOT(togglePlayback()));
+    connect(&playTimer, SIGNAL(timeout()), this, SLOT(playbackTick()));
 }
@@ -2,10 +2,14 @@
 #define MCLWINDOW_HPP
 
 #include <QVBoxLayout>
-#include <QScrollArea>
 #include <QWidget>
 #include <QSvgWidget>
 #include <QPushButton>
+#include <QElapsedTimer>
+#include <QLabel>
+#include <QSlider>
+#include <QSpinBox>
+#include <QTimer>
 #include "MclWidget.hpp"
 
 Q_DECLARE_METATYPE(QSvgWidget*);
@@ -13,18 +17,42 @@ Q_DECLARE_METATYPE(QSvgWidget*);
 class MclWindow : public QWidget {
     Q_OBJECT
 public:
-    explicit MclWindow(QWidget *parent = nullptr);
+    explicit MclWindow(MclStrategy s = MclStrategy::Greedy, QWidget *parent = nullptr);
+    void setRecorder(SearchRecorder *recorder);
+    bool replay(std::unique_ptr<SearchLog> log);
+signals:
+    void infoWidgetsLoaded();
+protected:
+    bool eventFilter(QObject *obj, QEvent *ev) override;
 private slots:
-    void mclUpdated(const MclWidget::GeometryTraverse &g);
+    void mclUpdated(const MclWidget::TreeDelta &delta);
+    void loadInfoWidgets();
+    void replayReady(qint64 events);
+    void replayMoved(int position);
+    void togglePlayback();
+    void playbackTick();
 private:
+    MclStrategy strategy;
     QHBoxLayout *mainBox;
-    QScrollArea *mclScroll;
+    QWidget *infoPanel;
     MclWidget *mcl;
     QPushButton *nextItButton;
     QPushButton *prevItButton;
+    QPushButton *zoomInButton;
+    QPushButton *zoomOutButton;
+    QPushButton *zoomResetButton;
+    QWidget *replayBar;
+    QPushButton *playButton;
+    QSlider *replaySlider;
+    QSpinBox *speedBox;
+    QLabel *positionLabel;
+    QTimer playTimer;
+    QElapsedTimer playClock;
+    double playPosition = 0;
     void initWindow();
     void initLayout();
     void addWidgets();
+    void addReplayWidgets(QVBoxLayout *layout);
     void addInfoWidgets();
     void initSignals();
 };
@@ -0,0 +1,419 @@
+#include "SolverDaemon.hpp"
+#include <QtDebug>
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalSocket>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+#include "trace.hpp"
+
+SolverDaemon::SolverDaemon(std::size_t size, std::size_t memoryBytes, QObject *parent)
+    : QObject(parent), cacheSize{size}, quota(memoryBytes)
+{
+    clock.start();
+    batchTimer.setSingleShot(true);
+    batchTimer.setInterval(0);
+    connect(&batchTimer, SIGNAL(timeout()), this, SLOT(dispatch()));
+    connect(&server, SIGNAL(newConnection()), this, SLOT(acceptConnection()));
+}
+
+bool SolverDaemon::listen(const QString &name)
+{
+    if (name == "-") {
+        if (!output.open(stdout, QIODevice::WriteOnly)) {
+            qCritical() << "Cannot open standard output:" << output.errorString();
+            return false;
+        }
+
+        input = new QSocketNotifier(STDIN_FILENO, QSocketNotifier::Read, this);
+        connect(input, SIGNAL(activated(int)), this, SLOT(readInput()));
+        return true;
+    }
+
+    QLocalServer::removeServer(name);
+    if (!server.listen(name)) {
+        qCritical() << "Cannot listen on" << name << ":" << server.errorString();
+        return false;
+    }
+    return true;
+}
+
+QJsonObject SolverDaemon::statistics() const
+{
+    QJsonObject json;
+    json["requests"] = double(requests);
+    json["cache_hits"] = double(hits);
+    json["cache_misses"] = double(misses);
+    json["cache_entries"] = double(cache.size());
+    json["errors"] = double(errors);
+    json["batches"] = double(batches);
+    json["running"] = running;
+    json["latency_us"] = latency.json();
+    json["solve_us"] = solveTime.json();
+    return json;
+}
+
+void SolverDaemon::acceptConnection()
+{
+    while (QLocalSocket *socket = server.nextPendingConnection()) {
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readSocket()));
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+    }
+}
+
+void SolverDaemon::readSocket()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>(sender());
+    while (socket != nullptr && socket->canReadLine()) {
+        handleLine(socket, socket->readLine());
+    }
+}
+
+void SolverDaemon::readInput()
+{
+    char buffer[1 << 16];
+    ssize_t n;
+    do {
+        n = ::read(STDIN_FILENO, buffer, sizeof buffer);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return;
+    } else if (n < 0) {
+        qCritical() << "Cannot read standard input:" << std::strerror(errno);
+    } else if (n > 0) {
+        inputBuffer.append(buffer, int(n));
+    }
+
+    int start = 0;
+    for (int end; (end = inputBuffer.indexOf('\n', start)) >= 0; start = end + 1) {
+        handleLine(&output, inputBuffer.mid(start, end - start));
+    }
+    inputBuffer.remove(0, start);
+
+    if (n <= 0) {
+        if (!inputBuffer.isEmpty()) {
+            handleLine(&output, inputBuffer);
+            inputBuffer.clear();
+        }
+        shutdown();
+    }
+}
+
+void SolverDaemon::handleLine(QIODevice *client, const QByteArray &line)
+{
+    if (line.trimmed().isEmpty()) {
+        return;
+    }
+
+    qint64 received = clock.nsecsElapsed() / 1000;
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+    if (!doc.isObject()) {
+        errors++;
+        QJsonObject result;
+        result["error"] = parseError.error != QJsonParseError::NoError ?
+            parseError.errorString() : QString("Request is not an object");
+        reply(client, QJsonValue(), result, received);
+        return;
+    }
+
+    QJsonObject json = doc.object();
+    QJsonValue id = json.value("id");
+    QString command = json.value("command").toString("solve");
+    if (command == "stats") {
+        reply(client, id, statistics(), received);
+        return;
+    } else if (command == "shutdown") {
+        reply(client, id, QJsonObject(), received);
+        shutdown();
+        return;
+    }
+
+    Query query;
+    QString error;
+    if (command != "solve") {
+        error = "Unknown command: " + command;
+    } else if (stopped) {
+        error = "Shutting down";
+    }
+
+    if (!error.isEmpty() || !parseQuery(json, query, error)) {
+        errors++;
+        QJsonObject result;
+        result["error"] = error;
+        reply(client, id, result, received);
+        return;
+    }
+
+    requests++;
+    std::string key = query.key();
+    if (const QJsonObject *cached = findCached(key)) {
+        hits++;
+        QJsonObject result = *cached;
+        result["cached"] = true;
+        reply(client, id, result, received);
+        return;
+    }
+
+    misses++;
+    QList<Request> &requestsForKey = waiting[key];
+    if (requestsForKey.isEmpty()) {
+        query.quota = &quota;
+        pending.push_back(query);
+        if (!batchTimer.isActive()) {
+            batchTimer.start();
+        }
+    }
+    requestsForKey.append({client, id, received});
+}
+
+bool SolverDaemon::parseQuery(const QJsonObject &json, Query &query, QString &error)
+{
+    query.instance.missionaries = json.value("missionaries").toInt(3);
+    query.instance.cannibals = json.value("cannibals").toInt(3);
+    query.instance.boat = json.value("boat").toInt(2);
+    query.strategy = json.value("strategy").toString("bidirectional");
+
+    const MclInstance &inst = query.instance;
+    if (inst.missionaries < 0 || inst.cannibals < 0 || inst.boat < 1) {
+        error = "Invalid instance";
+        return false;
+    }
+
+    MclSpace space(inst);
+    if (space.size() > (query.strategy == "external" ? maxExternalStates : maxStates)) {
+        error = "Instance too large for " + query.strategy;
+        return false;
+    }
+
+    query.start = space.start();
+    if (json.contains("start")) {
+        QJsonArray start = json.value("start").toArray();
+        if (start.size() != 3) {
+            error = "Start state must be [m, c, l]";
+            return false;
+        }
+
+        query.start = {start[0].toInt(-1), start[1].toInt(-1), start[2].toInt(-1)};
+        if (!space.contains(query.start)) {
+            error = "Start state outside the instance";
+            return false;
+        }
+    }
+
+    if (query.strategy != "bidirectional" && query.strategy != "external" &&
+        query.strategy != "sma" && query.strategy != "beam") {
+        error = "Unknown strategy: " + query.strategy;
+        return false;
+    }
+    return true;
+}
+
+std::string SolverDaemon::Query::key() const
+{
+    return std::to_string(instance.missionaries) + ":" + std::to_string(instance.cannibals) +
+           ":" + std::to_string(instance.boat) + ":" + std::to_string(start.m) + "," +
+           std::to_string(start.c) + "," + std::to_string(start.l) + ":" +
+           strategy.toStdString();
+}
+
+SolverDaemon::Answer SolverDaemon::solve(const Query &query)
+{
+    MCL_TRACE_SPAN("SolverDaemon::solve");
+    QElapsedTimer timer;
+    timer.start();
+
+    MclSpace space(query.instance, query.start);
+    MclSearchResult search;
+    QJsonObject result;
+    bool cacheable = true;
+    try {
+        if (query.strategy == "bidirectional") {
+            search = bidirectionalSearch(space, query.quota);
+        } else if (query.strategy == "external") {
+            MclExternalOptions options;
+            options.memoryBudget = std::min(options.memoryBudget,
+                                            query.quota->limit / externalShare);
+            options.quota = query.quota;
+            search = externalSearch(space, options);
+        } else {
+            MclBoundedOptions options;
+            options.mode = query.strategy == "beam" ? MclBoundedMode::Beam
+                                                    : MclBoundedMode::SMAStar;
+            options.quota = query.quota;
+            MclBoundedResult bounded = boundedSearch(space, options);
+            // What the quota left over depends on the rest of the batch, so
+            // such an answer is not kept for the next identical request.
+            if (bounded.quotaLimited) {
+                if (bounded.path.empty()) {
+                    throw std::runtime_error("Memory quota exhausted");
+                }
+                cacheable = false;
+            }
+            result["lower_bound"] = bounded.lowerBound;
+            result["gap"] = bounded.gap();
+            search = bounded;
+        }
+    } catch (const std::exception &e) {
+        result["error"] = e.what();
+    }
+
+    QJsonArray path;
+    for (const MclState &s : search.path) {
+        path.append(QJsonArray{s.m, s.c, s.l});
+    }
+    result["path"] = path;
+    result["length"] = int(search.path.size()) - 1;
+    result["expanded"] = double(search.expanded);
+    result["generated"] = double(search.generated);
+    return {query.key(), result, timer.nsecsElapsed() / 1000, cacheable};
+}
+
+void SolverDaemon::dispatch()
+{
+    if (pending.empty()) {
+        return;
+    }
+
+    batches++;
+    running++;
+    auto *watcher = new QFutureWatcher<Answer>(this);
+    connect(watcher, SIGNAL(resultReadyAt(int)), this, SLOT(answerReady(int)));
+    connect(watcher, SIGNAL(finished()), this, SLOT(batchFinished()));
+    watcher->setFuture(QtConcurrent::mapped(pending, &SolverDaemon::solve));
+    pending.clear();
+}
+
+void SolverDaemon::answerReady(int index)
+{
+    auto *watcher = static_cast<QFutureWatcher<Answer>*>(sender());
+    Answer answer = watcher->resultAt(index);
+    solveTime.add(answer.solveUs);
+    if (answer.cacheable && !answer.result.contains("error")) {
+        insertCached(answer.key, answer.result);
+    }
+
+    QList<Request> requestsForKey = waiting[answer.key];
+    waiting.erase(answer.key);
+    answer.result["cached"] = false;
+    for (const Request &request : requestsForKey) {
+        reply(request.client, request.id, answer.result, request.received);
+    }
+}
+
+void SolverDaemon::batchFinished()
+{
+    sender()->deleteLater();
+    running--;
+    checkFinished();
+}
+
+void SolverDaemon::reply(QIODevice *client, const QJsonValue &id, QJsonObject result,
+                         qint64 received)
+{
+    qint64 elapsed = clock.nsecsElapsed() / 1000 - received;
+    latency.add(elapsed);
+    if (client == nullptr) {
+        return;
+    }
+
+    if (!id.isUndefined()) {
+        result["id"] = id;
+    }
+    result["latency_us"] = double(elapsed);
+    client->write(QJsonDocument(result).toJson(QJsonDocument::Compact) + '\n');
+    if (client == &output) {
+        output.flush();
+    }
+}
+
+const QJsonObject *SolverDaemon::findCached(const std::string &key)
+{
+    auto it = cache.find(key);
+    if (it == cache.end()) {
+        return nullptr;
+    }
+
+    lru.splice(lru.begin(), lru, it->second.lru);
+    return &it->second.result;
+}
+
+void SolverDaemon::insertCached(const std::string &key, const QJsonObject &result)
+{
+    if (cacheSize == 0 || cache.count(key) > 0) {
+        return;
+    }
+
+    if (cache.size() == cacheSize) {
+        cache.erase(lru.back());
+        lru.pop_back();
+    }
+
+    lru.push_front(key);
+    cache[key] = {result, lru.begin()};
+}
+
+void SolverDaemon::shutdown()
+{
+    stopped = true;
+    server.close();
+    if (input != nullptr) {
+        input->setEnabled(false);
+    }
+    checkFinished();
+}
+
+void SolverDaemon::checkFinished()
+{
+    if (stopped && running == 0 && pending.empty()) {
+        emit finished();
+    }
+}
+
+void SolverDaemon::Histogram::add(qint64 us)
+{
+    counts[bucket(us)]++;
+    total++;
+    max = std::max(max, us);
+}
+
+int SolverDaemon::Histogram::bucket(qint64 us)
+{
+    if (us < 1) {
+        return 0;
+    }
+    int index = 1 + int(steps * std::log2(double(us)));
+    return std::min(index, bucketCount - 1);
+}
+
+qint64 SolverDaemon::Histogram::percentile(double p) const
+{
+    quint64 rank = quint64(std::ceil(p * total));
+    quint64 seen = 0;
+    for (std::size_t i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+        if (seen >= rank && seen > 0) {
+            qint64 upper = i == 0 ? 1 : qint64(std::ceil(std::exp2(double(i) / steps)));
+            return std::min(upper, max);
+        }
+    }
+    return max;
+}
+
+QJsonObject SolverDaemon::Histogram::json() const
+{
+    QJsonObject json;
+    json["count"] = double(total);
+    json["p50"] = double(percentile(0.5));
+    json["p90"] = double(percentile(0.9));
+    json["p99"] = double(percentile(0.99));
+    json["max"] = double(max);
+    return json;
+}
@@ -0,0 +1,121 @@
+#ifndef SOLVERDAEMON_HPP
+#define SOLVERDAEMON_HPP
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QList>
+#include <QLocalServer>
+#include <QPointer>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <array>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "search.hpp"
+
+class SolverDaemon : public QObject {
+    Q_OBJECT
+public:
+    static constexpr std::size_t const defaultMemoryBytes = std::size_t(2) << 30;
+
+    explicit SolverDaemon(std::size_t cacheSize = 1024,
+                          std::size_t memoryBytes = defaultMemoryBytes, QObject *parent = nullptr);
+    bool listen(const QString &name);
+    QJsonObject statistics() const;
+signals:
+    void finished();
+private slots:
+    void acceptConnection();
+    void readSocket();
+    void readInput();
+    void dispatch();
+    void answerReady(int index);
+    void batchFinished();
+private:
+    struct Query {
+        MclInstance instance;
+        MclState start;
+        QString strategy;
+        MclMemoryQuota *quota = nullptr;
+
+        std::string key() const;
+    };
+
+    struct Request {
+        QPointer<QIODevice> client;
+        QJsonValue id;
+        qint64 received;
+    };
+
+    struct Answer {
+        std::string key;
+        QJsonObject result;
+        qint64 solveUs;
+        bool cacheable;
+    };
+
+    struct CacheEntry {
+        QJsonObject result;
+        std::list<std::string>::iterator lru;
+    };
+
+    class Histogram {
+    public:
+        void add(qint64 us);
+        QJsonObject json() const;
+    private:
+        static constexpr int const steps = 8;
+        static constexpr int const bucketCount = 40 * steps;
+
+        static int bucket(qint64 us);
+        qint64 percentile(double p) const;
+
+        std::array<quint64, bucketCount> counts{};
+        quint64 total = 0;
+        qint64 max = 0;
+    };
+
+    static constexpr std::uint64_t const maxStates = std::uint64_t(1) << 26;
+    // External searches keep their layers on disk, a key per state, and may
+    // each hold at most this fraction of the memory quota.
+    static constexpr std::uint64_t const maxExternalStates = std::uint64_t(1) << 30;
+    static constexpr std::size_t const externalShare = 8;
+
+    static bool parseQuery(const QJsonObject &json, Query &query, QString &error);
+    static Answer solve(const Query &query);
+    void handleLine(QIODevice *client, const QByteArray &line);
+    void reply(QIODevice *client, const QJsonValue &id, QJsonObject result, qint64 received);
+    const QJsonObject *findCached(const std::string &key);
+    void insertCached(const std::string &key, const QJsonObject &result);
+    void shutdown();
+    void checkFinished();
+
+    QLocalServer server;
+    QFile output;
+    QSocketNotifier *input = nullptr;
+    QByteArray inputBuffer;
+    bool stopped = false;
+    QElapsedTimer clock;
+    QTimer batchTimer;
+    std::vector<Query> pending;
+    std::unordered_map<std::string, QList<Request>> waiting;
+    std::size_t cacheSize;
+    MclMemoryQuota quota;
+    std::unordered_map<std::string, CacheEntry> cache;
+    std::list<std::string> lru;
+    int running = 0;
+    Histogram latency;
+    Histogram solveTime;
+    quint64 requests = 0;
+    quint64 hits = 0;
+    quint64 misses = 0;
+    quint64 errors = 0;
+    quint64 batches = 0;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#include "StatsPanel.hpp"
+#include <QVBoxLayout>
+
+StatsPanel::StatsPanel(const MclStats &s, QWidget *parent)
+    : QWidget(parent), stats{s}
+{
+    QVBoxLayout *layout = new QVBoxLayout();
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(new QLabel("Estadísticas"), 0, Qt::AlignHCenter);
+    layout->addSpacing(10);
+
+    QFormLayout *form = new QFormLayout();
+    expanded = addRow(form, "Nodos expandidos:");
+    generated = addRow(form, "Nodos generados:");
+    duplicates = addRow(form, "Duplicados descartados:");
+    decreased = addRow(form, "Costos mejorados:");
+    reopened = addRow(form, "Nodos reabiertos:");
+    peakOpen = addRow(form, "Máximo en abiertos:");
+    peakClosed = addRow(form, "Máximo en cerrados:");
+    bytesPerNode = addRow(form, "Bytes por nodo:");
+    timings[MclStats::Next] = addRow(form, "Tiempo por iteración:");
+    timings[MclStats::Layout] = addRow(form, "Tiempo de disposición:");
+    timings[MclStats::Paint] = addRow(form, "Tiempo de pintado:");
+    layout->addLayout(form);
+    layout->addStretch();
+    setLayout(layout);
+
+    timer.setInterval(refreshInterval);
+    connect(&timer, SIGNAL(timeout()), this, SLOT(refresh()));
+    refresh();
+}
+
+void StatsPanel::refresh()
+{
+    expanded->setText(QString::number(stats.expanded));
+    generated->setText(QString::number(stats.generated));
+    duplicates->setText(QString::number(stats.duplicates));
+    decreased->setText(QString::number(stats.decreased));
+    reopened->setText(QString::number(stats.reopened));
+    peakOpen->setText(QString::number(stats.peakOpen));
+    peakClosed->setText(QString::number(stats.peakClosed));
+    bytesPerNode->setText(QString::number(stats.bytesPerNode(), 'f', 1));
+
+    for (int t = 0; t < MclStats::TimerCount; t++) {
+        const MclStats::Timing &timing = stats.timings[t];
+        timings[t]->setText(QString("%1 (máx. %2)")
+            .arg(formatTime(timing.meanNs()), formatTime(timing.maxNs)));
+    }
+}
+
+void StatsPanel::showEvent(QShowEvent *ev)
+{
+    refresh();
+    timer.start();
+    QWidget::showEvent(ev);
+}
+
+void StatsPanel::hideEvent(QHideEvent *ev)
+{
+    timer.stop();
+    QWidget::hideEvent(ev);
+}
+
+QString StatsPanel::formatTime(double ns)
+{
+    if (ns >= 1e6) {
+        return QString("%1 ms").arg(ns / 1e6, 0, 'f', 2);
+    } else if (ns >= 1e3) {
+        return QString("%1 µs").arg(ns / 1e3, 0, 'f', 1);
+    }
+    return QString("%1 ns").arg(ns, 0, 'f', 0);
+}
+
+QLabel *StatsPanel::addRow(QFormLayout *form, const QString &label)
+{
+    QLabel *value = new QLabel();
+    value->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    form->addRow(label, value);
+    return value;
+}
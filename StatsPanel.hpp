@@ -0,0 +1,37 @@
+#ifndef STATSPANEL_HPP
+#define STATSPANEL_HPP
+
+#include <QFormLayout>
+#include <QLabel>
+#include <QTimer>
+#include <QWidget>
+#include "stats.hpp"
+
+class StatsPanel : public QWidget {
+    Q_OBJECT
+public:
+    explicit StatsPanel(const MclStats &s, QWidget *parent = nullptr);
+public slots:
+    void refresh();
+protected:
+    void showEvent(QShowEvent *ev) override;
+    void hideEvent(QHideEvent *ev) override;
+private:
+    static constexpr int const refreshInterval = 250;
+
+    static QString formatTime(double ns);
+    QLabel *addRow(QFormLayout *form, const QString &label);
+    const MclStats &stats;
+    QTimer timer;
+    QLabel *expanded;
+    QLabel *generated;
+    QLabel *duplicates;
+    QLabel *decreased;
+    QLabel *reopened;
+    QLabel *peakOpen;
+    QLabel *peakClosed;
+    QLabel *bytesPerNode;
+    QLabel *timings[MclStats::TimerCount];
+};
+
+#endif
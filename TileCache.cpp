@@ -0,0 +1,85 @@
+#include "TileCache.hpp"
+#include <algorithm>
+
+TileCache::TileCache(int s, std::size_t b) : size{s}, budget{b}
+{
+}
+
+quint64 TileCache::key(int tx, int ty)
+{
+    return (quint64(quint32(tx)) << 32) | quint32(ty);
+}
+
+const QImage *TileCache::find(int tx, int ty)
+{
+    auto it = tiles.find(key(tx, ty));
+    if (it == tiles.end()) {
+        return nullptr;
+    }
+
+    lru.splice(lru.begin(), lru, it->second.lru);
+    return &it->second.image;
+}
+
+const QImage &TileCache::insert(int tx, int ty, const QImage &image)
+{
+    quint64 k = key(tx, ty);
+    erase(k);
+    evict();
+
+    lru.push_front(k);
+    Entry &entry = tiles[k];
+    entry.image = image;
+    entry.lru = lru.begin();
+    used += image.sizeInBytes();
+    return entry.image;
+}
+
+void TileCache::invalidate()
+{
+    tiles.clear();
+    lru.clear();
+    used = 0;
+}
+
+void TileCache::invalidate(const QRect &rect)
+{
+    if (rect.isEmpty()) {
+        return;
+    }
+
+    int tx0 = std::max(0, rect.left()) / size;
+    int ty0 = std::max(0, rect.top()) / size;
+    int tx1 = rect.right() / size;
+    int ty1 = rect.bottom() / size;
+
+    for (int ty = ty0; ty <= ty1; ty++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+            erase(key(tx, ty));
+        }
+    }
+}
+
+QRect TileCache::tileRect(int tx, int ty) const
+{
+    return QRect(tx * size, ty * size, size, size);
+}
+
+void TileCache::erase(quint64 k)
+{
+    auto it = tiles.find(k);
+    if (it == tiles.end()) {
+        return;
+    }
+
+    used -= it->second.image.sizeInBytes();
+    lru.erase(it->second.lru);
+    tiles.erase(it);
+}
+
+void TileCache::evict()
+{
+    while (used > budget && !lru.empty()) {
+        erase(lru.back());
+    }
+}
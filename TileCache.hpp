@@ -0,0 +1,37 @@
+#ifndef TILECACHE_HPP
+#define TILECACHE_HPP
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <QImage>
+#include <QRect>
+
+class TileCache {
+public:
+    explicit TileCache(int size = 256, std::size_t budget = 64 << 20);
+    const QImage *find(int tx, int ty);
+    const QImage &insert(int tx, int ty, const QImage &image);
+    void invalidate();
+    void invalidate(const QRect &rect);
+    QRect tileRect(int tx, int ty) const;
+    int tileSize() const { return size; }
+    std::size_t bytes() const { return used; }
+private:
+    struct Entry {
+        QImage image;
+        std::list<quint64>::iterator lru;
+    };
+
+    static quint64 key(int tx, int ty);
+    void erase(quint64 k);
+    void evict();
+
+    int size;
+    std::size_t budget;
+    std::size_t used = 0;
+    std::unordered_map<quint64, Entry> tiles;
+    std::list<quint64> lru;
+};
+
+#endif
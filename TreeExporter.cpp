@@ -0,0 +1,411 @@
+#include "TreeExporter.hpp"
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <QtDebug>
+#include <QBuffer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QPainter>
+#include <QSvgGenerator>
+#include <zlib.h>
+
+class PngStream {
+public:
+    explicit PngStream(QIODevice &o, int w, int h);
+    bool writeRows(const QImage &rows);
+    bool finish();
+private:
+    static void putU32(QByteArray &a, quint32 v);
+    bool chunk(const char *type, const QByteArray &data);
+    bool deflateRows(int flush);
+
+    QIODevice &out;
+    int width;
+    z_stream zs;
+    QByteArray idat;
+    bool ok;
+};
+
+PngStream::PngStream(QIODevice &o, int w, int h) : out{o}, width{w}, zs{}, ok{true}
+{
+    out.write("\x89PNG\r\n\x1a\n", 8);
+
+    QByteArray ihdr;
+    putU32(ihdr, w);
+    putU32(ihdr, h);
+    ihdr.append(char(8));
+    ihdr.append(char(6));
+    ihdr.append(3, char(0));
+    chunk("IHDR", ihdr);
+
+    ok = ok && deflateInit(&zs, Z_DEFAULT_COMPRESSION) == Z_OK;
+}
+
+void PngStream::putU32(QByteArray &a, quint32 v)
+{
+    a.append(char(v >> 24));
+    a.append(char(v >> 16));
+    a.append(char(v >> 8));
+    a.append(char(v));
+}
+
+bool PngStream::chunk(const char *type, const QByteArray &data)
+{
+    QByteArray c;
+    putU32(c, data.size());
+    c.append(type, 4);
+    c.append(data);
+    uLong crc = crc32(0, reinterpret_cast<const Bytef*>(c.constData() + 4),
+                      c.size() - 4);
+    putU32(c, crc);
+    ok = ok && out.write(c) == c.size();
+    return ok;
+}
+
+bool PngStream::deflateRows(int flush)
+{
+    char buf[1 << 16];
+    int ret;
+
+    do {
+        zs.next_out = reinterpret_cast<Bytef*>(buf);
+        zs.avail_out = sizeof(buf);
+        ret = deflate(&zs, flush);
+        if (ret == Z_STREAM_ERROR) {
+            return ok = false;
+        }
+
+        idat.append(buf, sizeof(buf) - zs.avail_out);
+        if (idat.size() >= (1 << 16)) {
+            chunk("IDAT", idat);
+            idat.clear();
+        }
+    } while (zs.avail_out == 0);
+
+    return ok;
+}
+
+bool PngStream::writeRows(const QImage &rows)
+{
+    QImage rgba = rows.convertToFormat(QImage::Format_RGBA8888);
+    QByteArray raw;
+    raw.reserve((width * 4 + 1) * rgba.height());
+    for (int y = 0; y < rgba.height(); y++) {
+        raw.append(char(0));
+        raw.append(reinterpret_cast<const char*>(rgba.constScanLine(y)), width * 4);
+    }
+
+    zs.next_in = reinterpret_cast<Bytef*>(raw.data());
+    zs.avail_in = raw.size();
+    return ok && deflateRows(Z_NO_FLUSH);
+}
+
+bool PngStream::finish()
+{
+    zs.next_in = nullptr;
+    zs.avail_in = 0;
+    deflateRows(Z_FINISH);
+    deflateEnd(&zs);
+
+    if (!idat.isEmpty()) {
+        chunk("IDAT", idat);
+    }
+
+    chunk("IEND", QByteArray());
+    return ok;
+}
+
+struct TreeExporter::JsonTraverse {
+    explicit JsonTraverse(const SearchView &v, QIODevice &o, bool nd)
+        : view{v}, out{o}, ndjson{nd}
+    {
+    }
+
+    void operator()(const SearchView::Nodes &nodes, int depth)
+    {
+        std::unordered_map<SearchView::Node, qint64> ids;
+        for (const auto &n : nodes) {
+            qint64 id = nextId++;
+            ids[n] = id;
+
+            QByteArray line;
+            if (!ndjson) {
+                line += id == 0 ? "\n  " : ",\n  ";
+            }
+
+            line += "{\"id\":" + QByteArray::number(id);
+            line += ",\"parent\":";
+            SearchView::Node parent = view.parent(n);
+            if (parent != nullptr) {
+                line += QByteArray::number(parentIds.at(parent));
+            } else {
+                line += "null";
+            }
+
+            line += ",\"depth\":" + QByteArray::number(depth);
+            line += ",\"op\":";
+            int op = view.op(n);
+            if (op >= 0) {
+                line += "\"" + MclWidget::opTag(op).toUtf8() + "\"";
+            } else {
+                line += "null";
+            }
+
+            line += "," + QByteArray::fromStdString(view.jsonFields(n));
+            line += ",\"vh\":" + QByteArray::number(view.priority(n));
+            line += ",\"expanded\":";
+            line += view.expanded(n) ? "true" : "false";
+            line += ",\"current\":";
+            line += n == view.current() ? "true" : "false";
+            line += ",\"target\":";
+            line += view.isTarget(n) ? "true" : "false";
+            line += "}";
+            if (ndjson) {
+                line += "\n";
+            }
+
+            ok = ok && out.write(line) == line.size();
+        }
+
+        parentIds.swap(ids);
+    }
+
+    const SearchView &view;
+    QIODevice &out;
+    bool ndjson;
+    bool ok = true;
+    qint64 nextId = 0;
+    std::unordered_map<SearchView::Node, qint64> parentIds;
+};
+
+struct TreeExporter::GraphicsTraverse {
+    explicit GraphicsTraverse(const MclWidget::GeometryTraverse &_g,
+                              const QSizeF &c, QIODevice &o, Format f)
+        : g{_g}, canvas{c}, out{o}, format{f}
+    {
+        SearchView::Nodes path = g.view.pathToCurrent();
+        onPath.insert(path.cbegin(), path.cend());
+        pen.setWidth(2);
+        if (format == Format::Png) {
+            png = new PngStream(out, std::ceil(canvas.width()), std::ceil(canvas.height()));
+        }
+    }
+
+    ~GraphicsTraverse()
+    {
+        delete png;
+    }
+
+    void operator()(const SearchView::Nodes &nodes, int depth)
+    {
+        std::vector<MclWidget::DisplayItem> items;
+        for (const auto &n : nodes) {
+            items.push_back(MclWidget::makeDisplayItem(g, n, onPath, glyphs));
+        }
+
+        if (format == Format::Svg) {
+            writeSvgLevel(items);
+        } else {
+            // A band ends at the centre line of its level. The lower half of
+            // the nodes goes into the next band, which also holds the edges
+            // to their children, so each level is painted into both.
+            double rowHeight = MclWidget::nodeHeight + MclWidget::vMargin;
+            double centre = MclWidget::treeVMargin + depth * rowHeight +
+                            MclWidget::nodeHeight / 2;
+            writePngRows(items, std::ceil(centre));
+            parents = std::move(items);
+        }
+    }
+
+    void paintItems(QPainter &painter, const std::vector<MclWidget::DisplayItem> &items)
+    {
+        painter.setPen(pen);
+        painter.setFont(glyphs.font);
+        for (const auto &item : items) {
+            QColor color = MclWidget::displayColor(item.color);
+            QPen cpen = pen;
+            if (color.isValid()) {
+                cpen.setColor(color);
+            }
+
+            painter.setPen(cpen);
+            MclWidget::paintNode(painter, item, item.center, glyphs);
+            painter.setPen(pen);
+            MclWidget::paintEdge(painter, item, glyphs);
+        }
+    }
+
+    void writeSvgLevel(const std::vector<MclWidget::DisplayItem> &items)
+    {
+        QBuffer buffer;
+        QSvgGenerator generator;
+        generator.setOutputDevice(&buffer);
+        generator.setSize(canvas.toSize());
+        generator.setViewBox(QRectF(QPointF(), canvas));
+
+        QPainter painter(&generator);
+        paintItems(painter, items);
+        painter.end();
+
+        const QByteArray &svg = buffer.data();
+        int start = svg.indexOf('>', svg.indexOf("<svg")) + 1;
+        int end = svg.lastIndexOf("</svg>");
+        out.write("<g>\n");
+        out.write(svg.constData() + start, end - start);
+        out.write("</g>\n");
+    }
+
+    void writePngRows(const std::vector<MclWidget::DisplayItem> &items, int bottom)
+    {
+        bottom = std::min(bottom, int(std::ceil(canvas.height())));
+        if (bottom <= rows) {
+            return;
+        }
+
+        QImage band(std::ceil(canvas.width()), bottom - rows,
+                    QImage::Format_ARGB32_Premultiplied);
+        band.fill(Qt::white);
+        QPainter painter(&band);
+        painter.translate(0, -rows);
+        paintItems(painter, parents);
+        paintItems(painter, items);
+        painter.end();
+
+        png->writeRows(band);
+        rows = bottom;
+    }
+
+    bool begin()
+    {
+        if (format == Format::Svg) {
+            QByteArray header;
+            QByteArray w = QByteArray::number(canvas.width());
+            QByteArray h = QByteArray::number(canvas.height());
+            header += "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n";
+            header += "<svg width=\"" + w + "\" height=\"" + h + "\" ";
+            header += "viewBox=\"0 0 " + w + " " + h + "\" ";
+            header += "xmlns=\"http://www.w3.org/2000/svg\" ";
+            header += "xmlns:xlink=\"http://www.w3.org/1999/xlink\" ";
+            header += "version=\"1.2\" baseProfile=\"tiny\">\n";
+            return out.write(header) == header.size();
+        }
+
+        return true;
+    }
+
+    bool end()
+    {
+        if (format == Format::Svg) {
+            return out.write("</svg>\n") > 0;
+        }
+
+        writePngRows({}, std::ceil(canvas.height()));
+        return png->finish();
+    }
+
+    const MclWidget::GeometryTraverse &g;
+    QSizeF canvas;
+    QIODevice &out;
+    Format format;
+    MclWidget::Glyphs glyphs;
+    QPen pen;
+    std::unordered_set<SearchView::Node> onPath;
+    std::vector<MclWidget::DisplayItem> parents;
+    PngStream *png = nullptr;
+    int rows = 0;
+};
+
+bool TreeExporter::formatFromName(const QString &name, Format &format)
+{
+    QString ext = QFileInfo(name).suffix().toLower();
+    if (ext.isEmpty()) {
+        ext = name.toLower();
+    }
+
+    if (ext == "svg") {
+        format = Format::Svg;
+    } else if (ext == "png") {
+        format = Format::Png;
+    } else if (ext == "json") {
+        format = Format::Json;
+    } else if (ext == "ndjson" || ext == "jsonl") {
+        format = Format::Ndjson;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+TreeExporter::TreeExporter(const SearchView &v) : view{v}
+{
+}
+
+bool TreeExporter::write(const QString &fileName, Format format)
+{
+    QFile file;
+    bool opened;
+    if (fileName == "-") {
+        opened = file.open(stdout, QIODevice::WriteOnly);
+    } else {
+        file.setFileName(fileName);
+        opened = file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    }
+
+    if (!opened) {
+        qWarning() << "Cannot open" << fileName << "for writing:" << file.errorString();
+        return false;
+    }
+
+    if (!write(file, format) || !file.flush()) {
+        qWarning() << "Cannot write" << fileName << ":" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool TreeExporter::write(QIODevice &out, Format format)
+{
+    switch (format) {
+    case Format::Json:
+        return writeJson(out, false);
+    case Format::Ndjson:
+        return writeJson(out, true);
+    default:
+        return writeGraphics(out, format);
+    }
+}
+
+bool TreeExporter::writeJson(QIODevice &out, bool ndjson)
+{
+    JsonTraverse jtraverse(view, out, ndjson);
+    if (!ndjson && out.write("[") != 1) {
+        return false;
+    }
+
+    view.traverse(std::ref(jtraverse));
+    if (!ndjson) {
+        jtraverse.ok = jtraverse.ok && out.write("\n]\n") == 3;
+    }
+
+    return jtraverse.ok;
+}
+
+bool TreeExporter::writeGraphics(QIODevice &out, Format format)
+{
+    MclWidget::GeometryTraverse g(view);
+    view.traverse(std::ref(g));
+    QSizeF canvas = MclWidget::layoutTree(g);
+
+    GraphicsTraverse gtraverse(g, canvas, out, format);
+    if (!gtraverse.begin()) {
+        return false;
+    }
+
+    view.traverse(std::ref(gtraverse));
+    return gtraverse.end();
+}
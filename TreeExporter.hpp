@@ -0,0 +1,29 @@
+#ifndef TREEEXPORTER_HPP
+#define TREEEXPORTER_HPP
+
+#include <QIODevice>
+#include <QString>
+#include "searchview.hpp"
+#include "MclWidget.hpp"
+
+class TreeExporter {
+public:
+    enum class Format {
+        Svg, Png, Json, Ndjson
+    };
+
+    static bool formatFromName(const QString &name, Format &format);
+    explicit TreeExporter(const SearchView &v);
+    bool write(const QString &fileName, Format format);
+    bool write(QIODevice &out, Format format);
+private:
+    struct JsonTraverse;
+    struct GraphicsTraverse;
+
+    bool writeJson(QIODevice &out, bool ndjson);
+    bool writeGraphics(QIODevice &out, Format format);
+
+    const SearchView &view;
+};
+
+#endif
@@ -0,0 +1,646 @@
+#include <QtDebug>
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MclWidget.hpp"
+#include "groups.hpp"
+#include "mcl.hpp"
+#include "parser.hpp"
+#include "pdb.hpp"
+#include "search.hpp"
+
+static volatile std::size_t sink;
+
+static void keep(std::size_t value)
+{
+    sink = sink + value;
+}
+
+class Bench {
+public:
+    explicit Bench(const QString &f, int s, double minTime)
+        : filter{f}, samples{s}, minSampleNs{minTime * 1e6}
+    {
+    }
+
+    void run(const QString &name, double items, const std::function<void()> &body)
+    {
+        if (!filter.isEmpty() && !name.contains(filter)) {
+            return;
+        }
+
+        std::uint64_t iterations = 1;
+        while (measure(body, iterations) < minSampleNs && iterations < (1ull << 30)) {
+            iterations *= 2;
+        }
+
+        std::vector<double> times;
+        for (int i = 0; i < samples; i++) {
+            times.push_back(measure(body, iterations) / iterations);
+        }
+        std::sort(times.begin(), times.end());
+
+        double mean = 0;
+        for (double t : times) {
+            mean += t / times.size();
+        }
+
+        QJsonObject result;
+        result["name"] = name;
+        result["iterations"] = double(iterations);
+        result["samples"] = samples;
+        result["items_per_op"] = items;
+        result["ns_per_op"] = times[times.size() / 2];
+        result["ns_per_op_min"] = times.front();
+        result["ns_per_op_mean"] = mean;
+        result["ns_per_item"] = times[times.size() / 2] / items;
+        results.append(result);
+
+        QTextStream(stderr) << QString("%1 %2 ns/op %3 ns/item\n")
+            .arg(name, -40)
+            .arg(times[times.size() / 2], 12, 'f', 1)
+            .arg(times[times.size() / 2] / items, 10, 'f', 2);
+    }
+
+    QJsonDocument report() const
+    {
+        QJsonObject root;
+        root["qt"] = QT_VERSION_STR;
+        root["compiler"] = __VERSION__;
+        root["benchmarks"] = results;
+        return QJsonDocument(root);
+    }
+private:
+    static double measure(const std::function<void()> &body, std::uint64_t iterations)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (std::uint64_t i = 0; i < iterations; i++) {
+            body();
+        }
+        std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+    QString filter;
+    int samples;
+    double minSampleNs;
+    QJsonArray results;
+};
+
+static QString instanceName(const MclInstance &inst)
+{
+    return QString("%1x%2b%3").arg(inst.missionaries).arg(inst.cannibals).arg(inst.boat);
+}
+
+struct JugsProblem {
+    struct State {
+        int a;
+        int b;
+    };
+
+    State start() const { return {0, 0}; }
+    std::uint64_t key(const State &s) const { return std::uint64_t(s.a) * (capB + 1) + s.b; }
+    bool isGoal(const State &s) const { return s.a == target || s.b == target; }
+    int heuristic(const State &s) const { return isGoal(s) ? 0 : 1; }
+    std::string toString(const State &s) const
+    {
+        return "(" + std::to_string(s.a) + ", " + std::to_string(s.b) + ")";
+    }
+
+    template<typename F>
+    void successors(const State &s, F &&func) const
+    {
+        int ab = std::min(s.a, capB - s.b);
+        int ba = std::min(s.b, capA - s.a);
+        func(State{capA, s.b}, 0);
+        func(State{s.a, capB}, 1);
+        func(State{0, s.b}, 2);
+        func(State{s.a, 0}, 3);
+        func(State{s.a - ab, s.b + ab}, 4);
+        func(State{s.a + ba, s.b - ba}, 5);
+    }
+
+    int capA;
+    int capB;
+    int target;
+};
+
+static void growTree(MclTree &tree, int steps)
+{
+    for (int i = 0; i < steps && tree.next(); i++) {
+    }
+}
+
+static std::vector<std::unique_ptr<MclNode>> distinctNodes(MclNode &parent)
+{
+    const MclInstance &inst = parent.problem->instance;
+    std::vector<std::unique_ptr<MclNode>> nodes;
+    for (int m = 0; m <= inst.missionaries; m++) {
+        for (int c = 0; c <= inst.cannibals; c++) {
+            for (int l = 0; l < 2; l++) {
+                int index = nodes.size();
+                nodes.emplace_back(new MclNode(MclState{m, c, l}, &parent, index % 64, index));
+            }
+        }
+    }
+    return nodes;
+}
+
+static void benchSearch(Bench &bench)
+{
+    const std::vector<MclInstance> instances = {
+        {3, 3, 2}, {10, 10, 3}, {30, 30, 4}, {100, 100, 5}, {300, 300, 6}
+    };
+
+    for (const auto &inst : instances) {
+        QString suffix = "/" + instanceName(inst);
+        MclTree tree(inst);
+        bench.run("iterate" + suffix, MclProblem::opCount(inst), [&tree]() {
+            keep(tree.root->iterate());
+            tree.root->uniterate();
+        });
+
+        bench.run("bidirectional" + suffix, 1, [&inst]() {
+            keep(bidirectionalSearch(inst).path.size());
+        });
+
+        for (MclStrategy strategy : {MclStrategy::Greedy, MclStrategy::AStar}) {
+            QString name = QString("next_to_goal/%1").arg(MclTree::strategyName(strategy));
+            bench.run(name + suffix, 1, [&inst, strategy]() {
+                MclTree t(inst, strategy);
+                while (t.next()) {
+                }
+                keep(t.closed.size());
+            });
+        }
+    }
+
+    MclInstance large{100, 100, 5};
+    const JugsProblem jugs{9973, 10007, 5000};
+    bench.run("jugs_astar/9973x10007", 1, [&jugs]() {
+        SearchTree<JugsProblem> tree(jugs, SearchStrategy::AStar);
+        while (tree.next()) {
+        }
+        keep(tree.current->depth);
+    });
+
+    for (bool symmetric : {false, true}) {
+        const MclGroupProblem groups(MclGroupInstance{8, 1, 4}, symmetric);
+        QString name = symmetric ? "groups_astar/8x1x4" : "groups_astar_raw/8x1x4";
+        bench.run(name, 1, [&groups]() {
+            MclGroupTree tree(groups, SearchStrategy::AStar);
+            while (tree.next()) {
+            }
+            keep(tree.uniq.size());
+        });
+    }
+
+    for (const char *name : {"people", "max", "sum"}) {
+        bench.run(QString("pdb_build/%1/").arg(name) + instanceName(large), 1, [&large, name]() {
+            MclPdbHeuristic pdb;
+            mclPdbFromName(name, large, std::string(), pdb);
+            keep(pdb.bytes());
+        });
+
+        MclPdbHeuristic pdb;
+        mclPdbFromName(name, large, std::string(), pdb);
+        bench.run(QString("astar_pdb/%1/").arg(name) + instanceName(large), 1, [&large, &pdb]() {
+            SearchTree<MclPdbProblem> tree(MclPdbProblem(MclProblem{large}, pdb),
+                                           SearchStrategy::AStar);
+            while (tree.next()) {
+            }
+            keep(tree.closed.size());
+        });
+    }
+
+    bench.run("external_bfs/" + instanceName(large), 1, [&large]() {
+        MclExternalOptions options;
+        options.memoryBudget = 1 << 20;
+        keep(externalSearch(large, options).path.size());
+    });
+
+    bench.run("count_solutions/" + instanceName(large), 1, [&large]() {
+        MclSolutions solutions(large);
+        keep(solutions.length());
+    });
+
+    bench.run("stream_solutions/" + instanceName(large), 1000, [&large]() {
+        static MclSolutions solutions(large);
+        MclPath path;
+        solutions.rewind();
+        for (int i = 0; i < 1000 && solutions.next(path); i++) {
+            keep(path.size());
+        }
+    });
+
+    for (MclBoundedMode mode : {MclBoundedMode::SMAStar, MclBoundedMode::Beam}) {
+        QString name = mode == MclBoundedMode::Beam ? "beam/" : "sma/";
+        bench.run(name + instanceName(large), 1, [&large, mode]() {
+            MclBoundedOptions options;
+            options.mode = mode;
+            options.maxNodes = 256;
+            keep(boundedSearch(large, options).path.size());
+        });
+    }
+
+    bench.run("sma_shared_quota/4x" + instanceName(large), 4, [&large]() {
+        MclMemoryQuota quota(1 << 20);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; i++) {
+            threads.emplace_back([&large, &quota]() {
+                MclBoundedOptions options;
+                options.quota = &quota;
+                keep(boundedSearch(large, options).path.size());
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    });
+
+    MclTree tree(large);
+    auto nodes = distinctNodes(*tree.root);
+
+    bench.run("uniq_insert/" + instanceName(large), nodes.size(), [&nodes]() {
+        decltype(MclTree::uniq) uniq;
+        for (const auto &n : nodes) {
+            uniq.insert(n.get());
+        }
+        keep(uniq.size());
+    });
+
+    bench.run("open_push_pop/" + instanceName(large), nodes.size(), [&nodes]() {
+        decltype(MclTree::open) open;
+        for (const auto &n : nodes) {
+            open.insert(n.get());
+        }
+        while (!open.empty()) {
+            open.erase(open.cbegin());
+        }
+    });
+}
+
+static void benchTree(Bench &bench)
+{
+    struct Count : MclTree::SequentialTraverse {
+        void operator()(const MclNode *node) override { count += node->depth; }
+        std::size_t count = 0;
+    };
+
+    struct LevelCount : MclTree::LevelTraverse {
+        void operator()(const MclTree::Nodes &nodes, int) override { count += nodes.size(); }
+        std::size_t count = 0;
+    };
+
+    for (const MclInstance &inst : {MclInstance{30, 30, 4}, MclInstance{300, 300, 6}}) {
+        MclTree tree(inst);
+        growTree(tree, 400);
+        QString suffix = "/" + instanceName(inst);
+        double size = tree.uniq.size();
+
+        MclNode *deep = tree.current;
+        MclNode *other = tree.closed[tree.closed.size() / 2];
+        bench.run("pathBetween/root" + suffix, deep->depth + 1, [&tree, deep]() {
+            keep(tree.pathBetween(tree.root, deep).size());
+        });
+
+        bench.run("pathBetween/siblings" + suffix, deep->depth + 1, [&tree, deep, other]() {
+            keep(tree.pathBetween(other, deep).size());
+        });
+
+        bench.run("traverse_sequential" + suffix, size, [&tree]() {
+            Count count;
+            tree.traverse(static_cast<MclTree::SequentialTraverse&>(count));
+            keep(count.count);
+        });
+
+        bench.run("traverse_level" + suffix, size, [&tree]() {
+            LevelCount count;
+            tree.traverse(static_cast<MclTree::LevelTraverse&>(count));
+            keep(count.count);
+        });
+
+        bench.run("visit_sequential" + suffix, size, [&tree]() {
+            std::size_t count = 0;
+            tree.traverse([&count](const MclNode *node) { count += node->depth; });
+            keep(count);
+        });
+
+        bench.run("visit_level" + suffix, size, [&tree]() {
+            std::size_t count = 0;
+            tree.traverse([&count](const MclTree::Level &nodes, int) { count += nodes.size(); });
+            keep(count);
+        });
+
+        bench.run("snapshot_then_step" + suffix, 1, [&tree]() {
+            MclSnapshot snapshot = tree.snapshot();
+            tree.previous();
+            tree.next();
+            keep(snapshot.size());
+        });
+
+        MclSnapshot snapshot = tree.snapshot();
+        bench.run("snapshot_traverse" + suffix, size, [&snapshot]() {
+            std::size_t count = 0;
+            snapshot.traverse([&count](std::uint32_t, const MclSnapshot::Node &node) {
+                count += node.depth;
+            });
+            keep(count);
+        });
+
+        MclView view(tree);
+        bench.run("geometry_traverse" + suffix, size, [&view]() {
+            MclWidget::GeometryTraverse g(view);
+            view.traverse(std::ref(g));
+            keep(MclWidget::layoutTree(g).width());
+        });
+    }
+}
+
+static void benchReplay(Bench &bench)
+{
+    const std::uint64_t events = 10000000;
+    std::string path = QDir::temp().filePath("mcl-bench.rec").toStdString();
+    {
+        SearchRecorder recorder(path, MclTree::recordHeader(MclInstance(), MclStrategy::Greedy));
+        MclTree tree;
+        tree.recorder = &recorder;
+        std::mt19937 rng(1);
+        while (recorder.events() < events) {
+            if (rng() % 3 == 0 || !tree.next()) {
+                tree.previous();
+            }
+        }
+        tree.recorder = nullptr;
+        recorder.close();
+    }
+
+    bench.run("replay_load", events, [&path]() {
+        keep(SearchLog(path).size());
+    });
+
+    SearchLog log(path);
+    MclTree tree;
+    SearchReplay<MclTree> replay(log, tree);
+    bench.run("replay_prepare", events, [&log]() {
+        MclTree scratch;
+        SearchReplay<MclTree> r(log, scratch);
+        r.prepare();
+        keep(r.divergent());
+    });
+
+    replay.prepare();
+    std::mt19937_64 rng(2);
+    bench.run("replay_seek", 1, [&replay, &tree, &log, &rng]() {
+        replay.seek(rng() % log.size());
+        keep(tree.closed.size());
+    });
+    QFile::remove(QString::fromStdString(path));
+}
+
+static void benchPaint(Bench &bench)
+{
+    MclWidget widget;
+    widget.resize(1280, 640);
+    widget.show();
+    QApplication::processEvents();
+
+    for (int i = 0; i < 32; i++) {
+        widget.nextIteration();
+    }
+    QApplication::processEvents();
+
+    bench.run("paint/cached", 1, [&widget]() {
+        widget.viewport()->repaint();
+    });
+
+    bench.run("paint/after_update", 1, [&widget]() {
+        widget.previousIteration();
+        widget.nextIteration();
+        widget.viewport()->repaint();
+    });
+
+    bench.run("paint/zoomed_out", 1, [&widget]() {
+        widget.zoomOut();
+        widget.viewport()->repaint();
+        widget.zoomIn();
+        widget.viewport()->repaint();
+    });
+
+    MclWidget jugs(std::unique_ptr<SearchView>(
+        new SearchViewFor<JugsProblem>(JugsProblem{3, 5, 4}, SearchStrategy::AStar)));
+    jugs.resize(1280, 640);
+    jugs.show();
+    for (int i = 0; i < 32; i++) {
+        jugs.nextIteration();
+    }
+    QApplication::processEvents();
+
+    bench.run("paint/jugs", 1, [&jugs]() {
+        jugs.previousIteration();
+        jugs.nextIteration();
+        jugs.viewport()->repaint();
+    });
+}
+
+static void benchParser(Bench &bench)
+{
+    std::string expr;
+    for (int i = 0; i < 1000; i++) {
+        expr += "m + 2 * c <= 3 & !(l = 1) | c >= m - 1 ^ 2 & ";
+    }
+    expr += "1";
+
+    bench.run("parseToken", expr.size(), [&expr]() {
+        auto it = expr.cbegin();
+        auto end = expr.cend();
+        std::size_t count = 0;
+        while (it != end) {
+            count += parseToken(it, end).token.size();
+        }
+        keep(count);
+    });
+
+    bench.run("shuntingYard", expr.size(), [&expr]() {
+        keep(shuntingYard(expr).size());
+    });
+
+    // (m <= M & c <= C) & (M - m) + (C - c) * 1 >= 0 & (B > 0 | m + c = 0)
+    PProgram rule;
+    auto var = [&rule](const char *name) -> PExpression& {
+        return rule.make<PVariable>(name);
+    };
+    auto op = [&rule](PBinaryOperator o, PExpression &l, PExpression &r) -> PExpression& {
+        return rule.make<PBinaryOperation>(o, l, r);
+    };
+    PExpression &zero = rule.make<PConstant>(0);
+    PExpression &bounds = op(PBinaryOperator::And,
+                             op(PBinaryOperator::LessEqual, var("m"), var("M")),
+                             op(PBinaryOperator::LessEqual, var("c"), var("C")));
+    PExpression &left = op(PBinaryOperator::Plus,
+                           op(PBinaryOperator::Minus, var("M"), var("m")),
+                           op(PBinaryOperator::Times,
+                              op(PBinaryOperator::Minus, var("C"), var("c")),
+                              rule.make<PConstant>(1)));
+    PExpression &boat = op(PBinaryOperator::Or, op(PBinaryOperator::Greater, var("B"), zero),
+                           op(PBinaryOperator::Equal,
+                              op(PBinaryOperator::Plus, var("m"), var("c")), zero));
+    rule.root = &op(PBinaryOperator::And,
+                    op(PBinaryOperator::And, bounds,
+                       op(PBinaryOperator::GreaterEqual, left, zero)), boat);
+
+    MclInstance instance;
+    PBindings known{{"M", double(instance.missionaries)}, {"C", double(instance.cannibals)},
+                    {"B", double(instance.boat)}};
+    PProgramCache cache(rule);
+    std::vector<PBindings> states;
+    std::vector<PBindings> full;
+    for (int m = 0; m <= instance.missionaries; m++) {
+        for (int c = 0; c <= instance.cannibals; c++) {
+            for (int l = 0; l <= 1; l++) {
+                states.push_back({{"m", double(m)}, {"c", double(c)}, {"l", double(l)}});
+                full.push_back(states.back());
+                full.back().insert(known.cbegin(), known.cend());
+            }
+        }
+    }
+
+    bench.run("rule_evaluate", full.size(), [&]() {
+        double total = 0;
+        for (const PBindings &bindings : full) {
+            total += pEvaluate(*rule.root, bindings);
+        }
+        keep(std::size_t(total));
+    });
+
+    bench.run("rule_specialised", states.size(), [&]() {
+        const PProgram &specialised = cache.specialise(known);
+        double total = 0;
+        for (const PBindings &state : states) {
+            total += pEvaluate(*specialised.root, state);
+        }
+        keep(std::size_t(total));
+    });
+}
+
+static int compare(const QString &baselineName, const QString &currentName, double threshold)
+{
+    auto load = [](const QString &name, QMap<QString, double> &times) {
+        QFile file(name);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qCritical() << "Cannot open" << name << ":" << file.errorString();
+            return false;
+        }
+
+        QJsonArray results = QJsonDocument::fromJson(file.readAll())
+            .object().value("benchmarks").toArray();
+        for (const auto &value : results) {
+            QJsonObject result = value.toObject();
+            times[result["name"].toString()] = result["ns_per_op"].toDouble();
+        }
+        return true;
+    };
+
+    QMap<QString, double> baseline;
+    QMap<QString, double> current;
+    if (!load(baselineName, baseline) || !load(currentName, current)) {
+        return 2;
+    }
+
+    QTextStream out(stdout);
+    int regressions = 0;
+    for (auto it = current.cbegin(); it != current.cend(); ++it) {
+        if (!baseline.contains(it.key())) {
+            out << QString("%1 %2 new\n").arg(it.key(), -40).arg(it.value(), 12, 'f', 1);
+            continue;
+        }
+
+        double before = baseline[it.key()];
+        double change = before > 0 ? it.value() / before - 1 : 0;
+        QString verdict;
+        if (change > threshold) {
+            verdict = "REGRESSION";
+            regressions++;
+        } else if (change < -threshold) {
+            verdict = "improved";
+        }
+
+        out << QString("%1 %2 %3 %4% %5\n").arg(it.key(), -40)
+            .arg(before, 12, 'f', 1).arg(it.value(), 12, 'f', 1)
+            .arg(change * 100, 7, 'f', 1).arg(verdict);
+    }
+
+    out << regressions << " regression(s) above " << threshold * 100 << "%\n";
+    return regressions > 0 ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addPositionalArgument("baseline current", "Result files for --compare.");
+    parser.addOptions({
+        {"output", "Write results as JSON to <file> (\"-\" for standard output).",
+                   "file", "-"},
+        {"filter", "Only run benchmarks whose name contains <text>.", "text"},
+        {"samples", "Number of timed samples per benchmark.", "n", "11"},
+        {"min-time", "Minimum duration of a sample in milliseconds.", "ms", "5"},
+        {"compare", "Compare two result files and flag regressions."},
+        {"threshold", "Relative slowdown reported as a regression, in percent.",
+                      "percent", "10"},
+    });
+    parser.process(app);
+
+    if (parser.isSet("compare")) {
+        QStringList files = parser.positionalArguments();
+        if (files.size() != 2) {
+            qCritical() << "--compare needs a baseline and a current result file";
+            return 2;
+        }
+        return compare(files[0], files[1], parser.value("threshold").toDouble() / 100);
+    }
+
+    Bench bench(parser.value("filter"), std::max(1, parser.value("samples").toInt()),
+                parser.value("min-time").toDouble());
+    benchSearch(bench);
+    benchTree(bench);
+    benchReplay(bench);
+    benchPaint(bench);
+    benchParser(bench);
+
+    QFile file;
+    QString fileName = parser.value("output");
+    bool opened;
+    if (fileName == "-") {
+        opened = file.open(stdout, QIODevice::WriteOnly);
+    } else {
+        file.setFileName(fileName);
+        opened = file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    }
+
+    if (!opened) {
+        qCritical() << "Cannot open" << fileName << "for writing:" << file.errorString();
+        return 2;
+    }
+
+    file.write(bench.report().toJson());
+    return 0;
+}
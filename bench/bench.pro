@@ -0,0 +1,14 @@
+TEMPLATE = app
+TARGET = bench
+
+QT = core gui svg concurrent widgets
+
+CONFIG += console release stats
+CONFIG -= app_bundle debug
+LIBS += -lz
+
+stats: DEFINES += MCL_STATS
+
+INCLUDEPATH += ..
+HEADERS += ../MclWidget.hpp ../TileCache.hpp ../mcl.hpp ../searchtree.hpp ../searchview.hpp ../recorder.hpp ../pdb.hpp ../groups.hpp ../persistent.hpp ../search.hpp ../stats.hpp ../trace.hpp ../parser.hpp
+SOURCES += bench.cpp ../MclWidget.cpp ../TileCache.cpp ../mcl.cpp ../bidirectional.cpp ../external.cpp ../solutions.cpp ../bounded.cpp ../pdb.cpp ../groups.cpp ../recorder.cpp ../stats.cpp ../trace.cpp ../parser.cpp
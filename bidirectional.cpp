@@ -0,0 +1,194 @@
+#include "search.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+class Barrier {
+public:
+    explicit Barrier(int n) : count{n}, waiting{0}, generation{0} { }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        int gen = generation;
+        if (++waiting == count) {
+            waiting = 0;
+            generation++;
+            cv.notify_all();
+        } else {
+            cv.wait(lock, [this, gen] { return gen != generation; });
+        }
+    }
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    int count;
+    int waiting;
+    int generation;
+};
+
+class Bidirectional {
+public:
+    static std::size_t tableBytes(const MclSpace &s)
+    {
+        return 2 * s.size() * sizeof(std::atomic<std::uint64_t>);
+    }
+
+    explicit Bidirectional(const MclSpace &s, MclMemoryQuota *quota)
+        : space(s), reservation(quota, tableBytes(s)),
+          visited{Table(space.size()), Table(space.size())}, barrier(2)
+    {
+    }
+
+    MclSearchResult run()
+    {
+        MclSearchResult result;
+        std::uint64_t start = space.key(space.start());
+        std::uint64_t goal = space.key(space.goal());
+        if (start == goal) {
+            result.path.push_back(space.start());
+            return result;
+        }
+
+        claim(Forward, start, start, 0);
+        claim(Backward, goal, goal, 0);
+
+        std::thread backward(&Bidirectional::expand, this, Backward, goal);
+        expand(Forward, start);
+        backward.join();
+
+        result.expanded = expanded[Forward] + expanded[Backward];
+        result.generated = generated[Forward] + generated[Backward];
+        if (bestCost != noPath) {
+            result.path = stitch();
+        }
+        return result;
+    }
+private:
+    enum Direction { Forward = 0, Backward = 1 };
+    using Table = std::vector<std::atomic<std::uint64_t>>;
+
+    static constexpr int const depthBits = 24;
+    static constexpr std::uint64_t const depthMask = (std::uint64_t(1) << depthBits) - 1;
+    static constexpr std::uint64_t const noPath = std::numeric_limits<std::uint64_t>::max();
+
+    bool claim(Direction d, std::uint64_t key, std::uint64_t parent, std::uint64_t depth)
+    {
+        std::uint64_t expected = 0;
+        std::uint64_t entry = ((parent + 1) << depthBits) | depth;
+        if (!visited[d][key].compare_exchange_strong(expected, entry)) {
+            return false;
+        }
+
+        std::uint64_t other = visited[1 - d][key].load();
+        if (other != 0) {
+            meet(key, depth + (other & depthMask));
+        }
+        return true;
+    }
+
+    void meet(std::uint64_t key, std::uint64_t cost)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cost < bestCost) {
+            bestCost = cost;
+            meeting = key;
+        }
+    }
+
+    void expand(Direction d, std::uint64_t origin)
+    {
+        std::vector<std::uint64_t> frontier = {origin};
+        std::vector<std::uint64_t> next;
+
+        for (std::uint64_t depth = 0; ; depth++) {
+            next.clear();
+            for (std::uint64_t key : frontier) {
+                expanded[d]++;
+                auto visit = [this, d, key, depth, &next](const MclState &s) {
+                    generated[d]++;
+                    std::uint64_t k = space.key(s);
+                    if (claim(d, k, key, depth + 1)) {
+                        next.push_back(k);
+                    }
+                };
+
+                if (d == Forward) {
+                    space.successors(space.state(key), visit);
+                } else {
+                    space.predecessors(space.state(key), visit);
+                }
+            }
+            frontier.swap(next);
+            exhausted[d] = frontier.empty();
+
+            barrier.wait();
+            bool done;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                bool anyExhausted = exhausted[Forward] || exhausted[Backward];
+                bool allExhausted = exhausted[Forward] && exhausted[Backward];
+                done = bestCost <= 2 * (depth + 1) || allExhausted ||
+                       (anyExhausted && bestCost == noPath);
+            }
+            barrier.wait();
+            if (done) {
+                return;
+            }
+        }
+    }
+
+    MclPath stitch() const
+    {
+        MclPath path;
+        for (std::uint64_t key = meeting; ; ) {
+            path.push_back(space.state(key));
+            std::uint64_t parent = (visited[Forward][key].load() >> depthBits) - 1;
+            if (parent == key) {
+                break;
+            }
+            key = parent;
+        }
+        std::reverse(path.begin(), path.end());
+
+        for (std::uint64_t key = meeting; ; ) {
+            std::uint64_t parent = (visited[Backward][key].load() >> depthBits) - 1;
+            if (parent == key) {
+                break;
+            }
+            key = parent;
+            path.push_back(space.state(key));
+        }
+        return path;
+    }
+
+    MclSpace space;
+    MclQuotaReservation reservation;
+    Table visited[2];
+    Barrier barrier;
+    std::mutex mutex;
+    std::uint64_t bestCost = noPath;
+    std::uint64_t meeting = 0;
+    std::uint64_t expanded[2] = {0, 0};
+    std::uint64_t generated[2] = {0, 0};
+    bool exhausted[2] = {false, false};
+};
+
+}
+
+MclSearchResult bidirectionalSearch(const MclInstance &inst)
+{
+    return bidirectionalSearch(MclSpace(inst));
+}
+
+MclSearchResult bidirectionalSearch(const MclSpace &space, MclMemoryQuota *quota)
+{
+    Bidirectional search(space, quota);
+    return search.run();
+}
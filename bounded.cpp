@@ -0,0 +1,430 @@
+#include "search.hpp"
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+using Key = std::uint64_t;
+
+constexpr int infinity = std::numeric_limits<int>::max();
+
+class Budget {
+public:
+    Budget(const MclBoundedOptions &options, std::size_t nodeBytes, MclBoundedResult &r)
+        : bytesPerNode{nodeBytes}, quota{options.quota}, result(r)
+    {
+        limit = std::max<std::size_t>(options.maxNodes, 2);
+        if (options.maxBytes > 0) {
+            limit = std::min(limit, std::max<std::size_t>(options.maxBytes / nodeBytes, 2));
+        }
+        result.bytesPerNode = nodeBytes;
+    }
+
+    ~Budget()
+    {
+        release(used);
+    }
+
+    // What this search could hold now, so paths that cannot fit while the
+    // quota is shared are cut off instead of pruned and regenerated forever.
+    std::size_t capacity()
+    {
+        if (quota == nullptr) {
+            return limit;
+        }
+        std::size_t shared = quota->used();
+        std::size_t room = shared < quota->limit ? (quota->limit - shared) / bytesPerNode : 0;
+        if (used + room < limit) {
+            result.quotaLimited = true;
+            return used + room;
+        }
+        return limit;
+    }
+
+    bool acquire(std::size_t nodes = 1)
+    {
+        if (used + nodes > limit) {
+            return false;
+        }
+        if (quota != nullptr && !quota->acquire(nodes * bytesPerNode)) {
+            result.quotaLimited = true;
+            return false;
+        }
+        used += nodes;
+        result.peakNodes = std::max(result.peakNodes, used);
+        return true;
+    }
+
+    void release(std::size_t nodes = 1)
+    {
+        if (quota != nullptr) {
+            quota->release(nodes * bytesPerNode);
+        }
+        used -= nodes;
+    }
+private:
+    std::size_t limit;
+    std::size_t used = 0;
+    std::size_t bytesPerNode;
+    MclMemoryQuota *quota;
+    MclBoundedResult &result;
+};
+
+class SmaStar {
+public:
+    explicit SmaStar(const MclSpace &s, const MclBoundedOptions &options)
+        : space(s), budget(options, bytesPerNode, result)
+    {
+    }
+
+    ~SmaStar()
+    {
+        std::vector<Node *> stack = {root};
+        while (!stack.empty() && stack.back() != nullptr) {
+            Node *n = stack.back();
+            stack.pop_back();
+            for (Node *c = n->child; c != nullptr; c = c->next) {
+                stack.push_back(c);
+            }
+            delete n;
+        }
+    }
+
+    MclBoundedResult run()
+    {
+        MclState start = space.start();
+        int h = space.heuristic(start);
+        result.lowerBound = h;
+        if (std::size_t(h) >= budget.capacity() || !budget.acquire()) {
+            return result;
+        }
+
+        root = add(nullptr, start, 0, h);
+
+        while (!open.empty() && (*open.begin())->f != infinity) {
+            Node *n = *open.begin();
+            if (n->state == space.goal()) {
+                result.lowerBound = n->g;
+                for (; n != nullptr; n = n->parent) {
+                    result.path.push_back(n->state);
+                }
+                std::reverse(result.path.begin(), result.path.end());
+                return result;
+            }
+
+            open.erase(open.begin());
+            expand(n);
+            if (starved) {
+                result.lowerBound = std::max(result.lowerBound, (*open.begin())->f);
+                return result;
+            }
+        }
+
+        return result;
+    }
+private:
+    struct Node {
+        MclState state;
+        int g;
+        int f;
+        int forgotten;
+        std::uint64_t id;
+        Node *parent;
+        Node *child;
+        Node *prev;
+        Node *next;
+    };
+
+    struct OpenCompare {
+        bool operator()(const Node *a, const Node *b) const
+        {
+            if (a->f != b->f) {
+                return a->f < b->f;
+            } else if (a->g != b->g) {
+                return a->g > b->g;
+            }
+            return a->id < b->id;
+        }
+    };
+
+    static constexpr std::size_t const bytesPerNode =
+        sizeof(Node) + 4 * sizeof(void *) + 3 * sizeof(void *) + sizeof(Key);
+
+    Node *add(Node *parent, const MclState &s, int g, int f)
+    {
+        Node *node = new Node{s, g, f, infinity, nextId++, parent, nullptr, nullptr, nullptr};
+        if (parent != nullptr) {
+            node->next = parent->child;
+            if (parent->child != nullptr) {
+                parent->child->prev = node;
+            }
+            parent->child = node;
+        }
+
+        Node *&best = table[space.key(s)];
+        if (best == nullptr || best->g > g) {
+            best = node;
+        }
+        open.insert(node);
+        return node;
+    }
+
+    void expand(Node *n)
+    {
+        result.expanded++;
+        n->forgotten = infinity;
+        expanding = n;
+        space.successors(n->state, [&](const MclState &s) {
+            result.generated++;
+            int g = n->g + 1;
+            auto it = table.find(space.key(s));
+            if (it != table.end() && it->second->g <= g) {
+                return;
+            }
+
+            int f = std::max(n->f, g + space.heuristic(s));
+            if (std::size_t(g) + 1 >= budget.capacity() && s != space.goal()) {
+                f = infinity;
+            }
+
+            while (!budget.acquire()) {
+                if (!pruneWorstLeaf()) {
+                    n->forgotten = std::min(n->forgotten, f);
+                    starved = true;
+                    return;
+                }
+            }
+            add(n, s, g, f);
+        });
+        expanding = nullptr;
+
+        if (n->child == nullptr) {
+            setF(n, n->forgotten);
+        }
+        if (n->child == nullptr || n->forgotten != infinity) {
+            open.insert(n);
+        }
+        backup(n);
+    }
+
+    void setF(Node *n, int f)
+    {
+        bool queued = open.erase(n) > 0;
+        n->f = f;
+        if (queued) {
+            open.insert(n);
+        }
+    }
+
+    void backup(Node *n)
+    {
+        for (; n != nullptr; n = n->parent) {
+            if (n->child == nullptr) {
+                continue;
+            }
+
+            int f = n->forgotten;
+            for (Node *c = n->child; c != nullptr; c = c->next) {
+                f = std::min(f, c->f);
+            }
+            if (f == n->f) {
+                break;
+            }
+            setF(n, f);
+        }
+    }
+
+    bool pruneWorstLeaf()
+    {
+        for (auto it = open.rbegin(); it != open.rend(); ++it) {
+            Node *w = *it;
+            if (w->child != nullptr || w == root) {
+                continue;
+            }
+
+            open.erase(w);
+            Node *p = w->parent;
+            p->forgotten = std::min(p->forgotten, w->f);
+            if (w->prev != nullptr) {
+                w->prev->next = w->next;
+            } else {
+                p->child = w->next;
+            }
+            if (w->next != nullptr) {
+                w->next->prev = w->prev;
+            }
+
+            auto entry = table.find(space.key(w->state));
+            if (entry->second == w) {
+                table.erase(entry);
+            }
+            delete w;
+            budget.release();
+            result.pruned++;
+
+            // The node being expanded is queued again once it is done.
+            if (p != expanding) {
+                open.insert(p);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    MclSpace space;
+    MclBoundedResult result;
+    Budget budget;
+    Node *root = nullptr;
+    Node *expanding = nullptr;
+    bool starved = false;
+    std::set<Node *, OpenCompare> open;
+    std::unordered_map<Key, Node *> table;
+    std::uint64_t nextId = 0;
+};
+
+class Beam {
+public:
+    explicit Beam(const MclSpace &s, const MclBoundedOptions &options)
+        : space(s), budget(options, bytesPerNode, result)
+    {
+        width = options.beamWidth;
+        if (width == 0) {
+            int h = std::min(space.heuristic(space.start()), 1 << 16);
+            width = std::max<std::size_t>(1, budget.capacity() / (2 * (h + 1)));
+        }
+    }
+
+    MclBoundedResult run()
+    {
+        int bound = infinity;
+        MclState start = space.start();
+        if (!budget.acquire()) {
+            return result;
+        }
+        layers.push_back({{start, 0}});
+        if (start == space.goal()) {
+            result.lowerBound = 0;
+            reconstruct();
+            return result;
+        }
+
+        for (int g = 1; ; g++) {
+            const std::vector<Node> &last = layers.back();
+            std::unordered_set<Key> seen;
+            for (std::size_t d = layers.size() >= 2 ? layers.size() - 2 : 0; d < layers.size(); d++) {
+                for (const Node &node : layers[d]) {
+                    seen.insert(space.key(node.state));
+                }
+            }
+
+            std::vector<std::pair<int, Node>> candidates;
+            for (std::size_t i = 0; i < last.size(); i++) {
+                result.expanded++;
+                space.successors(last[i].state, [&](const MclState &s) {
+                    result.generated++;
+                    if (seen.insert(space.key(s)).second) {
+                        candidates.push_back({space.heuristic(s), {s, std::uint32_t(i)}});
+                    }
+                });
+            }
+
+            MclState goal = space.goal();
+            std::stable_sort(candidates.begin(), candidates.end(),
+                             [&goal](const std::pair<int, Node> &a, const std::pair<int, Node> &b) {
+                                 if (a.first != b.first) {
+                                     return a.first < b.first;
+                                 }
+                                 return a.second.state == goal && b.second.state != goal;
+                             });
+
+            std::size_t kept = std::min(candidates.size(), width);
+            for (std::size_t i = kept; i < candidates.size(); i++) {
+                bound = std::min(bound, g + candidates[i].first);
+            }
+            result.pruned += candidates.size() - kept;
+
+            if (kept > 0 && !budget.acquire(kept)) {
+                bound = std::min(bound, g + candidates.front().first);
+                kept = 0;
+            }
+
+            if (kept == 0) {
+                result.lowerBound = std::max(bound, space.heuristic(start));
+                return result;
+            }
+
+            std::vector<Node> layer;
+            for (std::size_t i = 0; i < kept; i++) {
+                layer.push_back(candidates[i].second);
+            }
+            layers.push_back(std::move(layer));
+
+            if (candidates.front().second.state == goal) {
+                result.lowerBound = std::max(std::min(bound, g), space.heuristic(start));
+                reconstruct();
+                return result;
+            }
+        }
+    }
+private:
+    struct Node {
+        MclState state;
+        std::uint32_t parent;
+    };
+
+    static constexpr std::size_t const bytesPerNode = sizeof(Node) + 2 * sizeof(Key);
+
+    void reconstruct()
+    {
+        std::uint32_t index = 0;
+        for (auto it = layers.crbegin(); it != layers.crend(); ++it) {
+            result.path.push_back((*it)[index].state);
+            index = (*it)[index].parent;
+        }
+        std::reverse(result.path.begin(), result.path.end());
+    }
+
+    MclSpace space;
+    MclBoundedResult result;
+    Budget budget;
+    std::size_t width;
+    std::vector<std::vector<Node>> layers;
+};
+
+}
+
+bool MclMemoryQuota::acquire(std::size_t bytes)
+{
+    std::size_t current = used_.load(std::memory_order_relaxed);
+    do {
+        if (current + bytes > limit) {
+            return false;
+        }
+    } while (!used_.compare_exchange_weak(current, current + bytes, std::memory_order_relaxed));
+    return true;
+}
+
+MclBoundedResult boundedSearch(const MclInstance &inst, const MclBoundedOptions &options)
+{
+    return boundedSearch(MclSpace(inst), options);
+}
+
+MclBoundedResult boundedSearch(const MclSpace &space, const MclBoundedOptions &options)
+{
+    MclBoundedResult result;
+    if (options.mode == MclBoundedMode::Beam) {
+        Beam search(space, options);
+        result = search.run();
+    } else {
+        SmaStar search(space, options);
+        result = search.run();
+    }
+
+    if (result.lowerBound == infinity) {
+        result.lowerBound = -1;
+    }
+    return result;
+}
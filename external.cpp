@@ -0,0 +1,400 @@
+#include "search.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace {
+
+using Key = std::uint64_t;
+
+class ExternalError : public std::runtime_error {
+public:
+    explicit ExternalError(const std::string &what, const std::string &path)
+        : std::runtime_error(what + " " + path + ": " + std::strerror(errno))
+    {
+    }
+};
+
+class RunWriter {
+public:
+    explicit RunWriter(const std::string &p, std::size_t blockKeys, MclExternalResult &r)
+        : path{p}, block(blockKeys), result(r)
+    {
+        file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+            throw ExternalError("Cannot create", path);
+        }
+        std::setvbuf(file, nullptr, _IONBF, 0);
+    }
+
+    ~RunWriter()
+    {
+        if (file != nullptr) {
+            std::fclose(file);
+        }
+    }
+
+    void put(Key key)
+    {
+        block[used++] = key;
+        count++;
+        if (used == block.size()) {
+            flush();
+        }
+    }
+
+    std::uint64_t close()
+    {
+        flush();
+        if (std::fclose(file) != 0) {
+            file = nullptr;
+            throw ExternalError("Cannot write", path);
+        }
+        file = nullptr;
+        return count;
+    }
+private:
+    void flush()
+    {
+        if (used > 0 && std::fwrite(block.data(), sizeof(Key), used, file) != used) {
+            throw ExternalError("Cannot write", path);
+        }
+        result.bytesWritten += used * sizeof(Key);
+        used = 0;
+    }
+
+    std::string path;
+    std::FILE *file;
+    std::vector<Key> block;
+    std::size_t used = 0;
+    std::uint64_t count = 0;
+    MclExternalResult &result;
+};
+
+class RunReader {
+public:
+    explicit RunReader(const std::string &p, std::size_t blockKeys, MclExternalResult &r)
+        : path{p}, block(blockKeys), result(r)
+    {
+        file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            throw ExternalError("Cannot open", path);
+        }
+        std::setvbuf(file, nullptr, _IONBF, 0);
+        fill();
+    }
+
+    ~RunReader()
+    {
+        std::fclose(file);
+    }
+
+    bool done() const { return pos == used; }
+    Key peek() const { return block[pos]; }
+
+    Key pop()
+    {
+        Key key = block[pos++];
+        if (pos == used) {
+            fill();
+        }
+        return key;
+    }
+
+    bool skipTo(Key key)
+    {
+        while (!done() && peek() < key) {
+            pop();
+        }
+        return !done() && peek() == key;
+    }
+private:
+    void fill()
+    {
+        used = std::fread(block.data(), sizeof(Key), block.size(), file);
+        if (used == 0 && std::ferror(file)) {
+            throw ExternalError("Cannot read", path);
+        }
+        result.bytesRead += used * sizeof(Key);
+        pos = 0;
+    }
+
+    std::string path;
+    std::FILE *file;
+    std::vector<Key> block;
+    std::size_t pos = 0;
+    std::size_t used = 0;
+    MclExternalResult &result;
+};
+
+class ExternalBfs {
+public:
+    static std::size_t budgetOf(const MclExternalOptions &options)
+    {
+        return std::max<std::size_t>(options.memoryBudget, 64 << 10);
+    }
+
+    explicit ExternalBfs(const MclSpace &s, const MclExternalOptions &options)
+        : space(s), reservation(options.quota, budgetOf(options))
+    {
+        std::size_t budget = budgetOf(options);
+        blockKeys = std::min<std::size_t>(std::max<std::size_t>(budget / 64, 4096),
+                                          1 << 20) / sizeof(Key);
+        sortKeys = budget / 2 / sizeof(Key);
+        fanIn = std::max<std::size_t>(2, budget / 2 / (blockKeys * sizeof(Key)) - 3);
+        result.residentBytes = sortKeys * sizeof(Key) + (fanIn + 3) * blockKeys * sizeof(Key);
+
+        std::string dir = options.directory;
+        if (dir.empty()) {
+            const char *tmp = std::getenv("TMPDIR");
+            dir = tmp != nullptr && *tmp != '\0' ? tmp : "/tmp";
+        }
+
+        std::string pattern = dir + "/mcl-bfs-XXXXXX";
+        std::vector<char> buffer(pattern.cbegin(), pattern.cend());
+        buffer.push_back('\0');
+        if (mkdtemp(buffer.data()) == nullptr) {
+            throw ExternalError("Cannot create directory in", dir);
+        }
+        directory = buffer.data();
+    }
+
+    ~ExternalBfs()
+    {
+        for (const auto &file : files) {
+            std::remove(file.c_str());
+        }
+        rmdir(directory.c_str());
+    }
+
+    MclExternalResult run()
+    {
+        Key start = space.key(space.start());
+        Key goal = space.key(space.goal());
+        if (start == goal) {
+            result.path.push_back(space.start());
+            return result;
+        }
+
+        {
+            files.push_back(layerPath(0));
+            RunWriter layer(layerPath(0), 1, result);
+            layer.put(start);
+            result.layers.push_back(layer.close());
+        }
+
+        for (std::size_t d = 0; result.layers.back() > 0; d++) {
+            if (expandLayer(d, goal)) {
+                result.path = reconstruct(d + 1);
+                break;
+            }
+        }
+        return result;
+    }
+private:
+    std::string layerPath(std::size_t depth) const
+    {
+        return directory + "/layer-" + std::to_string(depth);
+    }
+
+    std::string runPath()
+    {
+        files.push_back(directory + "/run-" + std::to_string(runCount++));
+        return files.back();
+    }
+
+    bool expandLayer(std::size_t d, Key goal)
+    {
+        std::vector<std::string> runs;
+        {
+            std::vector<Key> buffer;
+            buffer.reserve(sortKeys);
+            RunReader layer(layerPath(d), blockKeys, result);
+            while (!layer.done()) {
+                Key key = layer.pop();
+                result.expanded++;
+                space.successors(space.state(key), [&](const MclState &s) {
+                    result.generated++;
+                    buffer.push_back(space.key(s));
+                    if (buffer.size() == sortKeys) {
+                        runs.push_back(writeRun(buffer));
+                    }
+                });
+            }
+
+            if (!buffer.empty() || runs.empty()) {
+                runs.push_back(writeRun(buffer));
+            }
+        }
+        result.runs += runs.size();
+
+        while (runs.size() > fanIn) {
+            std::vector<std::string> merged;
+            for (std::size_t i = 0; i < runs.size(); i += fanIn) {
+                std::vector<std::string> group(runs.begin() + i,
+                                               runs.begin() + std::min(runs.size(), i + fanIn));
+                std::string path = runPath();
+                RunWriter out(path, blockKeys, result);
+                merge(group, [&out](Key key) { out.put(key); });
+                out.close();
+                removeRuns(group);
+                merged.push_back(path);
+            }
+            runs.swap(merged);
+        }
+
+        bool found = false;
+        files.push_back(layerPath(d + 1));
+        RunWriter next(layerPath(d + 1), blockKeys, result);
+        std::unique_ptr<RunReader> previous[2];
+        previous[0].reset(new RunReader(layerPath(d), blockKeys, result));
+        if (d > 0) {
+            previous[1].reset(new RunReader(layerPath(d - 1), blockKeys, result));
+        }
+
+        merge(runs, [&](Key key) {
+            for (const auto &layer : previous) {
+                if (layer && layer->skipTo(key)) {
+                    return;
+                }
+            }
+            next.put(key);
+            found = found || key == goal;
+        });
+        removeRuns(runs);
+        result.layers.push_back(next.close());
+        return found;
+    }
+
+    std::string writeRun(std::vector<Key> &buffer)
+    {
+        std::sort(buffer.begin(), buffer.end());
+        buffer.erase(std::unique(buffer.begin(), buffer.end()), buffer.end());
+        std::string path = runPath();
+        RunWriter run(path, blockKeys, result);
+        for (Key key : buffer) {
+            run.put(key);
+        }
+        run.close();
+        buffer.clear();
+        return path;
+    }
+
+    void merge(const std::vector<std::string> &runs, const std::function<void(Key)> &out)
+    {
+        std::vector<std::unique_ptr<RunReader>> readers;
+        using Head = std::pair<Key, std::size_t>;
+        std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+        for (const auto &path : runs) {
+            readers.emplace_back(new RunReader(path, blockKeys, result));
+            if (!readers.back()->done()) {
+                heads.push({readers.back()->peek(), readers.size() - 1});
+            }
+        }
+
+        bool any = false;
+        Key last = 0;
+        while (!heads.empty()) {
+            Head head = heads.top();
+            heads.pop();
+            RunReader &reader = *readers[head.second];
+            reader.pop();
+            if (!reader.done()) {
+                heads.push({reader.peek(), head.second});
+            }
+
+            if (!any || head.first != last) {
+                out(head.first);
+                last = head.first;
+                any = true;
+            }
+        }
+    }
+
+    void removeRuns(const std::vector<std::string> &runs)
+    {
+        for (const auto &path : runs) {
+            std::remove(path.c_str());
+            files.erase(std::find(files.begin(), files.end(), path));
+        }
+    }
+
+    bool layerContains(std::size_t depth, Key key)
+    {
+        std::FILE *file = std::fopen(layerPath(depth).c_str(), "rb");
+        if (file == nullptr) {
+            throw ExternalError("Cannot open", layerPath(depth));
+        }
+
+        std::uint64_t lo = 0;
+        std::uint64_t hi = result.layers[depth];
+        while (lo < hi) {
+            std::uint64_t mid = lo + (hi - lo) / 2;
+            Key value;
+            if (std::fseek(file, long(mid * sizeof(Key)), SEEK_SET) != 0 ||
+                std::fread(&value, sizeof(Key), 1, file) != 1) {
+                std::fclose(file);
+                throw ExternalError("Cannot read", layerPath(depth));
+            }
+            result.bytesRead += sizeof(Key);
+
+            if (value == key) {
+                std::fclose(file);
+                return true;
+            } else if (value < key) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        std::fclose(file);
+        return false;
+    }
+
+    MclPath reconstruct(std::size_t depth)
+    {
+        MclPath path = {space.goal()};
+        while (depth-- > 0) {
+            MclState found = path.back();
+            space.predecessors(path.back(), [&](const MclState &s) {
+                if (found == path.back() && layerContains(depth, space.key(s))) {
+                    found = s;
+                }
+            });
+            path.push_back(found);
+        }
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+
+    MclSpace space;
+    MclQuotaReservation reservation;
+    MclExternalResult result;
+    std::string directory;
+    std::vector<std::string> files;
+    std::size_t runCount = 0;
+    std::size_t blockKeys;
+    std::size_t sortKeys;
+    std::size_t fanIn;
+};
+
+}
+
+MclExternalResult externalSearch(const MclInstance &inst, const MclExternalOptions &options)
+{
+    return externalSearch(MclSpace(inst), options);
+}
+
+MclExternalResult externalSearch(const MclSpace &space, const MclExternalOptions &options)
+{
+    ExternalBfs search(space, options);
+    return search.run();
+}
@@ -0,0 +1,48 @@
+#include "groups.hpp"
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+constexpr int const MclGroupState::maxGroups;
+
+MclGroupProblem::MclGroupProblem(const MclGroupInstance &inst, bool s)
+    : instance(inst), symmetric{s}
+{
+    if (inst.groups < 0 || inst.groups > State::maxGroups) {
+        throw std::runtime_error("Unsupported number of groups: " + std::to_string(inst.groups));
+    }
+
+    double keys = 2;
+    for (int g = 0; g < inst.groups; g++) {
+        keys *= codes();
+    }
+    // Codes go up to 2 * followers + 1 and must fit in a byte.
+    const int maxFollowers = (std::numeric_limits<std::uint8_t>::max() - 1) / 2;
+    if (inst.followers < 0 || inst.followers > maxFollowers || keys > 1.8e19) {
+        throw std::runtime_error("Too many followers per group: " +
+                                 std::to_string(inst.followers));
+    }
+}
+
+// Without the jealousy rule only the number of people left matters, which
+// is a missionaries and cannibals instance with nobody to keep safe.
+int MclGroupProblem::heuristic(const State &s) const
+{
+    int people = 0;
+    for (int g = 0; g < instance.groups; g++) {
+        people += s.groups[g] / (instance.followers + 1) + s.groups[g] % (instance.followers + 1);
+    }
+    return MclProblem{MclInstance{people, 0, instance.boat}}.heuristic(MclState{people, 0, s.l});
+}
+
+std::string MclGroupProblem::toString(const State &s) const
+{
+    std::ostringstream os;
+    os << "(";
+    for (int g = 0; g < instance.groups; g++) {
+        os << (g > 0 ? ", " : "") << s.groups[g] / (instance.followers + 1) << "/"
+           << s.groups[g] % (instance.followers + 1);
+    }
+    os << "; " << s.l << ")";
+    return os.str();
+}
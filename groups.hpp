@@ -0,0 +1,146 @@
+#ifndef GROUPS_HPP
+#define GROUPS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include "mcl.hpp"
+
+// Jealous-husbands-style variants: every group is a leader and its
+// followers, and a follower may not share a bank or the boat with another
+// group's leader unless her own leader is there too. With one follower per
+// group this is the classic puzzle of the jealous husbands.
+struct MclGroupInstance {
+    int groups = 3;
+    int followers = 1;
+    int boat = 2;
+};
+
+// Each group is coded as leader on the left * (followers + 1) + followers
+// on the left; l is the side of the boat, as in MclState.
+struct MclGroupState {
+    static constexpr int const maxGroups = 16;
+
+    std::array<std::uint8_t, maxGroups> groups;
+    int l;
+
+    bool operator==(const MclGroupState &o) const { return groups == o.groups && l == o.l; }
+    bool operator!=(const MclGroupState &o) const { return !(*this == o); }
+};
+
+// Groups are interchangeable, so with symmetry reduction key() sorts their
+// codes first and every permutation of a state shares one key. The nodes
+// keep the concrete states, so paths stay valid move by move.
+struct MclGroupProblem {
+    using State = MclGroupState;
+
+    MclGroupProblem() = default;
+    explicit MclGroupProblem(const MclGroupInstance &inst, bool symmetric = true);
+
+    State start() const
+    {
+        State s{};
+        for (int g = 0; g < instance.groups; g++) {
+            s.groups[g] = std::uint8_t(code(true, instance.followers));
+        }
+        return s;
+    }
+
+    std::uint64_t key(const State &s) const
+    {
+        std::array<std::uint8_t, State::maxGroups> groups = s.groups;
+        if (symmetric) {
+            std::sort(groups.begin(), groups.begin() + instance.groups);
+        }
+
+        std::uint64_t k = 0;
+        for (int g = 0; g < instance.groups; g++) {
+            k = k * codes() + groups[g];
+        }
+        return k * 2 + s.l;
+    }
+
+    bool isGoal(const State &s) const
+    {
+        return s.l == 1 && std::all_of(s.groups.cbegin(), s.groups.cbegin() + instance.groups,
+                                       [](std::uint8_t c) { return c == 0; });
+    }
+
+    int heuristic(const State &s) const;
+    std::string toString(const State &s) const;
+
+    template<typename F>
+    void successors(const State &s, F &&func) const
+    {
+        State next = s;
+        next.l = 1 - s.l;
+        int op = 0;
+        board(s, next, 0, instance.boat, 0, 0, op, func);
+    }
+
+    MclGroupInstance instance;
+    bool symmetric = true;
+private:
+    int codes() const { return 2 * (instance.followers + 1); }
+    int code(bool leaderLeft, int followersLeft) const
+    {
+        return leaderLeft * (instance.followers + 1) + followersLeft;
+    }
+
+    // Only a leader keeps a follower of another group safe from him.
+    static bool safe(std::uint32_t leaders, std::uint32_t followers)
+    {
+        return leaders == 0 || (followers & ~leaders) == 0;
+    }
+
+    bool safeBanks(const State &s) const
+    {
+        std::uint32_t leaders[2] = {0, 0};
+        std::uint32_t followers[2] = {0, 0};
+        for (int g = 0; g < instance.groups; g++) {
+            int leaderLeft = s.groups[g] / (instance.followers + 1);
+            int followersLeft = s.groups[g] % (instance.followers + 1);
+            leaders[1 - leaderLeft] |= 1u << g;
+            followers[0] |= std::uint32_t(followersLeft > 0) << g;
+            followers[1] |= std::uint32_t(followersLeft < instance.followers) << g;
+        }
+        return safe(leaders[0], followers[0]) && safe(leaders[1], followers[1]);
+    }
+
+    // Chooses how many of each group board, group by group, and reports
+    // every non-empty load that leaves the boat and both banks safe.
+    template<typename F>
+    void board(const State &s, State &next, int g, int seats, std::uint32_t leaders,
+               std::uint32_t followers, int &op, F &func) const
+    {
+        if (g == instance.groups) {
+            if (seats < instance.boat && safe(leaders, followers) && safeBanks(next)) {
+                func(next, op++);
+            }
+            return;
+        }
+
+        const int k = instance.followers;
+        const int leaderLeft = s.groups[g] / (k + 1);
+        const int followersLeft = s.groups[g] % (k + 1);
+        const int leaderHere = s.l == 0 ? leaderLeft : 1 - leaderLeft;
+        const int followersHere = s.l == 0 ? followersLeft : k - followersLeft;
+        const int sign = s.l == 0 ? -1 : 1;
+
+        for (int dl = 0; dl <= leaderHere && dl <= seats; dl++) {
+            for (int df = 0; df <= followersHere && dl + df <= seats; df++) {
+                next.groups[g] = std::uint8_t(code(leaderLeft + sign * dl != 0,
+                                                   followersLeft + sign * df));
+                board(s, next, g + 1, seats - dl - df,
+                      leaders | std::uint32_t(dl) << g,
+                      followers | std::uint32_t(df > 0) << g, op, func);
+            }
+        }
+        next.groups[g] = s.groups[g];
+    }
+};
+
+using MclGroupTree = SearchTree<MclGroupProblem>;
+
+#endif
@@ -0,0 +1,79 @@
+#!/bin/sh
+# Renders the formulas whose .tex content changed since the last run into
+# <dir> (build by default) and writes formulas.manifest (name, sha256, svg)
+# and formulas.qrc for qmake next to the SVGs, so the sources stay clean.
+set -eu
+cd "$(dirname "$0")"
+SELF=./$(basename "$0")
+
+MANIFEST=formulas.manifest
+QRC=formulas.qrc
+JOBS=${JOBS:-$(nproc 2>/dev/null || echo 1)}
+
+hash_of() {
+    sha256sum < "$1" | cut -d ' ' -f 1
+}
+
+if [ "${1:-}" = "--render" ]; then
+    name=$2
+    OUT=$3
+    dir=$OUT/tex/$name
+    mkdir -p "$dir"
+    pdflatex -interaction=batchmode -halt-on-error -shell-escape \
+        -output-directory="$dir" "$name.tex" > /dev/null
+    dvisvgm --pdf -o "$OUT/$name.svg" "$dir/$name.pdf" > /dev/null 2>&1
+    hash_of "$name.tex" > "$OUT/tex/$name.sha256"
+    echo "formula $name"
+    exit 0
+fi
+
+OUT=${1:-build}
+mkdir -p "$OUT/tex"
+names=$(ls *.tex | sed 's/\.tex$//' | sort -V)
+stale=
+for name in $names; do
+    stamp=$OUT/tex/$name.sha256
+    if [ ! -f "$OUT/$name.svg" ] || [ ! -f "$stamp" ] ||
+       [ "$(cat "$stamp")" != "$(hash_of "$name.tex")" ]; then
+        stale="$stale $name"
+    fi
+done
+
+status=0
+if [ -n "$stale" ]; then
+    printf '%s\n' $stale | xargs -P "$JOBS" -I '{}' "$SELF" --render '{}' "$OUT" || status=$?
+fi
+
+{
+    for name in $names; do
+        stamp=$OUT/tex/$name.sha256
+        if [ -f "$OUT/$name.svg" ] && [ -f "$stamp" ]; then
+            echo "$name $(cat "$stamp") $name.svg"
+        fi
+    done
+} > "$OUT/$MANIFEST.tmp"
+
+{
+    echo '<!DOCTYPE RCC><RCC version="1.0">'
+    echo '<qresource prefix="/latex">'
+    echo "    <file>$MANIFEST</file>"
+    for name in $names; do
+        echo "    <file>$name.svg</file>"
+    done
+    echo '</qresource>'
+    echo '</RCC>'
+} > "$OUT/$QRC.tmp"
+
+# A new manifest means new SVGs, so the .qrc is touched too and rcc runs
+# again even if the list of files did not change.
+changed=
+for f in "$MANIFEST" "$QRC"; do
+    if [ -z "$changed" ] && cmp -s "$OUT/$f.tmp" "$OUT/$f"; then
+        rm "$OUT/$f.tmp"
+    else
+        mv "$OUT/$f.tmp" "$OUT/$f"
+        changed=1
+    fi
+done
+
+exit $status
@@ -1,16 +1,125 @@
 #include <QtDebug>
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QTextStream>
+#include <QTimer>
 #include "MclWindow.hpp"
+#include "SolverDaemon.hpp"
+#include "TreeExporter.hpp"
+#include "groups.hpp"
+#include "pdb.hpp"
+#include "search.hpp"
+#include "searchview.hpp"
+#include "trace.hpp"
 
 QApplication *initApplication(int &argc, char **argv);
-MclWindow *initMainWindow();
+MclWindow *initMainWindow(MclStrategy strategy);
+void initCommandLine(QCommandLineParser &parser);
+void initTrace(const QCommandLineParser &parser);
+int runHeadless(const QCommandLineParser &parser, MclStrategy strategy);
+int runSolve(const QCommandLineParser &parser);
+int runServe(const QCommandLineParser &parser, QCoreApplication &app);
+int runSolutions(const QCommandLineParser &parser, const MclInstance &instance);
+int runGroups(const QCommandLineParser &parser);
+int runPdbSearch(const QCommandLineParser &parser, const MclInstance &instance,
+                 MclSearchResult &result);
+void runSteps(MclTree &tree, const QString &steps);
+int runExport(const QCommandLineParser &parser, const SearchView &view);
+int writeStats(const QCommandLineParser &parser, const MclTree &tree);
 
 int main(int argc, char **argv)
 {
+    QElapsedTimer startup;
+    startup.start();
+
+    for (int i = 1; i < argc; i++) {
+        if ((qstrncmp(argv[i], "--export", 8) == 0 ||
+             qstrncmp(argv[i], "--stats", 7) == 0 ||
+             qstrncmp(argv[i], "--solve", 7) == 0 ||
+             qstrncmp(argv[i], "--serve", 7) == 0) &&
+            qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+    }
+
     QApplication *app = initApplication(argc, argv);
-    MclWindow *window = initMainWindow();
+    QCommandLineParser parser;
+    initCommandLine(parser);
+    parser.process(*app);
+    initTrace(parser);
+
+    MclStrategy strategy;
+    if (!MclTree::strategyFromName(parser.value("strategy").toStdString(), strategy)) {
+        qCritical() << "Unknown search strategy:" << parser.value("strategy");
+        return 1;
+    }
+
+    if (parser.isSet("solve")) {
+        int status = runSolve(parser);
+        return Trace::stop() ? status : 1;
+    }
+
+    if (parser.isSet("serve")) {
+        int status = runServe(parser, *app);
+        return Trace::stop() ? status : 1;
+    }
+
+    if (parser.isSet("export") || parser.isSet("stats")) {
+        int status = runHeadless(parser, strategy);
+        return Trace::stop() ? status : 1;
+    }
+
+    std::unique_ptr<SearchLog> log;
+    std::unique_ptr<SearchRecorder> recorder;
+    try {
+        if (parser.isSet("replay")) {
+            log.reset(new SearchLog(parser.value("replay").toStdString()));
+            MclInstance inst;
+            if (!MclTree::fromRecordHeader(log->header, inst, strategy)) {
+                qCritical() << "Not a search recording:" << parser.value("replay");
+                return 1;
+            }
+        } else if (parser.isSet("record")) {
+            recorder.reset(new SearchRecorder(parser.value("record").toStdString(),
+                                              MclTree::recordHeader(MclInstance(), strategy)));
+        }
+    } catch (const std::exception &e) {
+        qCritical() << e.what();
+        return 1;
+    }
+
+    MclWindow *window = initMainWindow(strategy);
+    if (log && !window->replay(std::move(log))) {
+        return 1;
+    }
+    window->setRecorder(recorder.get());
+
+    if (parser.isSet("startup-time")) {
+        QTimer::singleShot(0, [&startup]() {
+            qInfo().nospace() << "Window shown after " << startup.elapsed() << " ms";
+        });
+        QObject::connect(window, &MclWindow::infoWidgetsLoaded, [&startup]() {
+            qInfo().nospace() << "Formulas loaded after " << startup.elapsed() << " ms";
+        });
+    }
+
     window->show();
-    return app->exec();
+    int status = app->exec();
+    if (recorder) {
+        window->setRecorder(nullptr);
+        try {
+            recorder->close();
+        } catch (const std::exception &e) {
+            qCritical() << e.what();
+            status = 1;
+        }
+    }
+    Trace::stop();
+    return status;
 }
 
 QApplication *initApplication(int &argc, char **argv)
@@ -20,11 +129,385 @@ QApplication *initApplication(int &argc, char **argv)
     return app;
 }
 
-MclWindow *initMainWindow()
+MclWindow *initMainWindow(MclStrategy strategy)
 {
-    MclWindow *window = new MclWindow();
+    MclWindow *window = new MclWindow(strategy);
     window->setWindowTitle(QCoreApplication::applicationName());
     window->setFixedSize(1280, 640);
     window->setFocusPolicy(Qt::ClickFocus);
     return window;
 }
+
+void initCommandLine(QCommandLineParser &parser)
+{
+    parser.addHelpOption();
+    parser.addOptions({
+        {"strategy", "Search strategy: greedy (the default) or astar.", "name",
+                     "greedy"},
+        {"steps", "Run <n> search iterations before exporting, or until the "
+                  "target is reached with \"goal\".", "n", "0"},
+        {"export", "Write the search tree to <file> without opening a window "
+                   "(\"-\" for standard output). Also the tree of --solve groups.",
+                   "file"},
+        {"format", "Export format: svg, png, json or ndjson. Defaults to the "
+                   "extension of the export file.", "format"},
+        {"startup-time", "Print how long the window and the formula panel took "
+                         "to appear."},
+        {"stats", "Write search statistics to <file> without opening a window "
+                  "(\"-\" for standard output).", "file"},
+        {"stats-format", "Statistics format: csv or json. Defaults to the "
+                         "extension of the statistics file, or csv.", "format"},
+        {"solve", "Solve the instance given by --missionaries, --cannibals and "
+                  "--boat with <method> (bidirectional, astar, external, sma or beam) "
+                  "and print the path. The count method prints the number of optimal "
+                  "solutions and all prints every one of them. The groups method solves "
+                  "the jealous-husbands variant given by --groups, --followers and --boat.",
+                  "method"},
+        {"missionaries", "Number of missionaries for --solve.", "n", "3"},
+        {"cannibals", "Number of cannibals for --solve.", "n", "3"},
+        {"boat", "Boat capacity for --solve.", "n", "2"},
+        {"groups", "Number of interchangeable groups for --solve groups.", "n", "3"},
+        {"followers", "Followers of each group leader for --solve groups.", "n", "1"},
+        {"no-symmetry", "Tell apart states that only differ by a permutation of the "
+                        "groups in --solve groups."},
+        {"memory", "Memory budget in MiB for --solve external, sma and beam, and "
+                   "shared by the searches of --serve (2048 by default there).",
+                   "MiB", "64"},
+        {"nodes", "Maximum number of nodes kept by --solve sma and beam.", "n",
+                  "65536"},
+        {"beam-width", "Nodes kept per depth by --solve beam. Derived from the "
+                       "budget by default.", "w"},
+        {"tmpdir", "Directory for the layer files of --solve external.", "dir"},
+        {"pdb", "Pattern databases for --solve astar: people, max (people, "
+                "missionaries and cannibals) or sum (additive projections).", "name"},
+        {"pdb-dir", "Directory where --pdb tables are stored and memory-mapped from. "
+                    "Tables are kept in memory only when unset.", "dir"},
+        {"solution", "Print the optimal solution with index <k>, counting from "
+                     "zero, for --solve count.", "k"},
+        {"serve", "Answer newline-delimited JSON solve requests on the local "
+                  "socket <name> (\"-\" for standard input and output).", "name"},
+        {"cache", "Number of solved instances kept by --serve.", "n", "1024"},
+        {"record", "Record every step of the search to <file> as a compact binary log.",
+                   "file"},
+        {"replay", "Open the window replaying a log written by --record.", "file"},
+        {"trace", "Record profiling spans and write them to <file> as Chrome "
+                  "trace JSON on exit. MCL_TRACE=<file> does the same.", "file"},
+    });
+}
+
+void initTrace(const QCommandLineParser &parser)
+{
+    if (parser.isSet("trace")) {
+        Trace::start(parser.value("trace").toStdString());
+    } else if (!qEnvironmentVariableIsEmpty("MCL_TRACE")) {
+        Trace::start(qgetenv("MCL_TRACE").toStdString());
+    }
+}
+
+int runHeadless(const QCommandLineParser &parser, MclStrategy strategy)
+{
+    MclTree tree(MclInstance(), strategy);
+    std::unique_ptr<SearchRecorder> recorder;
+    try {
+        if (parser.isSet("record")) {
+            recorder.reset(new SearchRecorder(parser.value("record").toStdString(),
+                                              MclTree::recordHeader(MclInstance(), strategy)));
+            tree.recorder = recorder.get();
+        }
+        runSteps(tree, parser.value("steps"));
+        if (recorder) {
+            tree.recorder = nullptr;
+            recorder->close();
+        }
+    } catch (const std::exception &e) {
+        qCritical() << e.what();
+        return 1;
+    }
+
+    if (parser.isSet("export")) {
+        int status = runExport(parser, MclView(tree));
+        if (status != 0) {
+            return status;
+        }
+    }
+
+    if (parser.isSet("stats")) {
+        return writeStats(parser, tree);
+    }
+
+    return 0;
+}
+
+int runSolve(const QCommandLineParser &parser)
+{
+    MclInstance instance;
+    instance.missionaries = parser.value("missionaries").toInt();
+    instance.cannibals = parser.value("cannibals").toInt();
+    instance.boat = parser.value("boat").toInt();
+    if (instance.missionaries < 0 || instance.cannibals < 0 || instance.boat < 1) {
+        qCritical() << "Invalid instance";
+        return 1;
+    }
+
+    QString method = parser.value("solve");
+    MclSearchResult result;
+    if (method == "count" || method == "all") {
+        return runSolutions(parser, instance);
+    } else if (method == "groups") {
+        return runGroups(parser);
+    } else if (method == "bidirectional") {
+        result = bidirectionalSearch(instance);
+    } else if (method == "astar") {
+        int status = runPdbSearch(parser, instance, result);
+        if (status != 0) {
+            return status;
+        }
+    } else if (method == "sma" || method == "beam") {
+        MclBoundedOptions options;
+        options.mode = method == "beam" ? MclBoundedMode::Beam : MclBoundedMode::SMAStar;
+        options.maxNodes = parser.value("nodes").toULongLong();
+        options.maxBytes = std::size_t(parser.value("memory").toDouble() * (1 << 20));
+        options.beamWidth = parser.value("beam-width").toULongLong();
+        MclBoundedResult bounded = boundedSearch(instance, options);
+        QString bound = bounded.lowerBound < 0 ? QString("unknown")
+                                               : QString::number(bounded.lowerBound);
+        qInfo().nospace() << "lower bound " << qPrintable(bound)
+                          << ", gap " << bounded.gap()
+                          << ", peak nodes " << bounded.peakNodes
+                          << ", bytes per node " << bounded.bytesPerNode
+                          << ", pruned " << bounded.pruned;
+        result = bounded;
+    } else if (method == "external") {
+        MclExternalOptions options;
+        options.directory = parser.value("tmpdir").toStdString();
+        options.memoryBudget = std::size_t(parser.value("memory").toDouble() * (1 << 20));
+        try {
+            MclExternalResult external = externalSearch(instance, options);
+            qInfo().nospace() << "layers " << external.layers.size()
+                              << ", read " << external.bytesRead << " bytes"
+                              << ", written " << external.bytesWritten << " bytes"
+                              << ", sorted runs " << external.runs
+                              << ", buffers " << external.residentBytes << " bytes";
+            result = external;
+        } catch (const std::exception &e) {
+            qCritical() << e.what();
+            return 1;
+        }
+    } else {
+        qCritical() << "Unknown solving method:" << method;
+        return 1;
+    }
+
+    QTextStream out(stdout);
+    for (const MclState &s : result.path) {
+        out << QString::fromStdString(s) << "\n";
+    }
+
+    qInfo().nospace() << "length " << int(result.path.size()) - 1
+                      << ", expanded " << result.expanded
+                      << ", generated " << result.generated;
+    return result.path.empty() ? 2 : 0;
+}
+
+int runServe(const QCommandLineParser &parser, QCoreApplication &app)
+{
+    std::size_t memory = SolverDaemon::defaultMemoryBytes;
+    if (parser.isSet("memory")) {
+        memory = std::size_t(parser.value("memory").toDouble() * (1 << 20));
+    }
+    SolverDaemon daemon(parser.value("cache").toULongLong(), memory);
+    if (!daemon.listen(parser.value("serve"))) {
+        return 1;
+    }
+
+    QObject::connect(&daemon, &SolverDaemon::finished, &app, &QCoreApplication::quit,
+                     Qt::QueuedConnection);
+    int status = app.exec();
+    qInfo().noquote() << QJsonDocument(daemon.statistics()).toJson(QJsonDocument::Compact);
+    return status;
+}
+
+int runPdbSearch(const QCommandLineParser &parser, const MclInstance &instance,
+                 MclSearchResult &result)
+{
+    MclPdbHeuristic pdb;
+    if (parser.isSet("pdb")) {
+        try {
+            if (!mclPdbFromName(parser.value("pdb").toStdString(), instance,
+                                parser.value("pdb-dir").toStdString(), pdb)) {
+                qCritical() << "Unknown pattern database:" << parser.value("pdb");
+                return 1;
+            }
+        } catch (const std::exception &e) {
+            qCritical() << e.what();
+            return 1;
+        }
+    }
+
+    SearchTree<MclPdbProblem> tree(MclPdbProblem(MclProblem{instance}, pdb),
+                                   MclStrategy::AStar);
+    while (tree.next()) {
+    }
+
+    if (tree.isTarget(tree.current)) {
+        for (const auto *node : tree.pathBetween(tree.root, tree.current)) {
+            result.path.push_back(node->state());
+        }
+    }
+    result.expanded = tree.closed.size();
+    result.generated = tree.uniq.size();
+    qInfo().nospace() << "pattern databases " << pdb.databases.size()
+                      << ", " << pdb.bytes() << " bytes";
+    return 0;
+}
+
+int runGroups(const QCommandLineParser &parser)
+{
+    MclGroupInstance instance;
+    instance.groups = parser.value("groups").toInt();
+    instance.followers = parser.value("followers").toInt();
+    instance.boat = parser.value("boat").toInt();
+    if (instance.boat < 1) {
+        qCritical() << "Invalid instance";
+        return 1;
+    }
+
+    MclGroupProblem problem;
+    try {
+        problem = MclGroupProblem(instance, !parser.isSet("no-symmetry"));
+    } catch (const std::exception &e) {
+        qCritical() << e.what();
+        return 1;
+    }
+
+    MclGroupTree tree(problem, MclStrategy::AStar);
+    while (tree.next()) {
+    }
+
+    bool solved = tree.isTarget(tree.current);
+    QTextStream out(stdout);
+    if (solved && parser.value("export") != "-") {
+        for (const auto *node : tree.pathBetween(tree.root, tree.current)) {
+            out << QString::fromStdString(problem.toString(node->state())) << "\n";
+        }
+    }
+
+    qInfo().nospace() << "length " << (solved ? tree.current->depth : -1)
+                      << ", expanded " << tree.closed.size()
+                      << ", generated " << tree.uniq.size();
+    if (parser.isSet("export")) {
+        out.flush();
+        int status = runExport(parser, SearchViewFor<MclGroupProblem>(tree));
+        if (status != 0) {
+            return status;
+        }
+    }
+    return solved ? 0 : 2;
+}
+
+int runSolutions(const QCommandLineParser &parser, const MclInstance &instance)
+{
+    MclSolutions solutions(instance);
+    if (!solutions.solvable()) {
+        qInfo() << "No solution";
+        return 2;
+    }
+
+    qInfo().nospace() << "length " << solutions.length()
+                      << ", solutions " << QString::fromStdString(solutions.count());
+
+    QTextStream out(stdout);
+    if (parser.value("solve") == "all") {
+        MclPath path;
+        while (solutions.next(path)) {
+            QStringList states;
+            for (const MclState &s : path) {
+                states << QString::fromStdString(s);
+            }
+            out << states.join(" ") << "\n";
+        }
+    } else if (parser.isSet("solution")) {
+        MclBigUint index;
+        if (!MclBigUint::fromString(parser.value("solution").toStdString(), index) ||
+            !(index < solutions.count())) {
+            qCritical() << "Invalid solution index:" << parser.value("solution");
+            return 1;
+        }
+
+        for (const MclState &s : solutions.at(index)) {
+            out << QString::fromStdString(s) << "\n";
+        }
+    } else {
+        out << QString::fromStdString(solutions.count()) << "\n";
+    }
+    return 0;
+}
+
+void runSteps(MclTree &tree, const QString &steps)
+{
+    if (steps == "goal") {
+        while (tree.next()) {
+        }
+    } else {
+        int n = steps.toInt();
+        for (int i = 0; i < n && tree.next(); i++) {
+        }
+    }
+}
+
+int runExport(const QCommandLineParser &parser, const SearchView &view)
+{
+    QString fileName = parser.value("export");
+    QString formatName = parser.isSet("format") ? parser.value("format") : fileName;
+    TreeExporter::Format format;
+    if (!TreeExporter::formatFromName(formatName, format)) {
+        qCritical() << "Unknown export format:" << formatName;
+        return 1;
+    }
+
+    TreeExporter exporter(view);
+    return exporter.write(fileName, format) ? 0 : 1;
+}
+
+int writeStats(const QCommandLineParser &parser, const MclTree &tree)
+{
+    if (!MclStats::enabled) {
+        qCritical() << "Statistics were disabled at compile time";
+        return 1;
+    }
+
+    QString fileName = parser.value("stats");
+    QString format = parser.value("stats-format").toLower();
+    if (format.isEmpty()) {
+        format = QFileInfo(fileName).suffix().toLower();
+        if (format != "json") {
+            format = "csv";
+        }
+    }
+
+    std::string data;
+    if (format == "csv") {
+        data = tree.stats.csv();
+    } else if (format == "json") {
+        data = tree.stats.json();
+    } else {
+        qCritical() << "Unknown statistics format:" << format;
+        return 1;
+    }
+
+    QFile file;
+    bool opened;
+    if (fileName == "-") {
+        opened = file.open(stdout, QIODevice::WriteOnly);
+    } else {
+        file.setFileName(fileName);
+        opened = file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    }
+
+    if (!opened) {
+        qCritical() << "Cannot open" << fileName << "for writing:" << file.errorString();
+        return 1;
+    }
+
+    return file.write(data.data(), data.size()) == qint64(data.size()) ? 0 : 1;
+}
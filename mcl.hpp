@@ -1,96 +1,97 @@
 #ifndef TREE_HPP
 #define TREE_HPP
 
-#include <memory>
+#include <cstdint>
 #include <string>
 #include <vector>
-#include <deque>
-#include <functional>
-#include <set>
-#include <unordered_set>
+#include "searchtree.hpp"
 
-class MclNode {
-public:
-    explicit MclNode(int _m, int _c, int _l, MclNode *p, int d, int i, int o = -1);
-    explicit MclNode(int _m, int _c, int _l);
-    operator std::string() const;
-    constexpr int vh() const { return 6 - 2 * m - 2 * c - 1000 * (m != c); }
-    int iterate();
-    void uniterate();
+struct MclInstance {
+    int missionaries = 3;
+    int cannibals = 3;
+    int boat = 2;
+};
 
+struct MclState {
     int m;
     int c;
     int l;
-    MclNode *parent;
-    int depth;
-    int index;
-    int op;
-    int ccount;
-    std::vector<std::unique_ptr<MclNode>> children;
-private:
-    void addChild(int _m, int _c, int _l, int _op = -1);
+
+    bool operator==(const MclState &o) const { return m == o.m && c == o.c && l == o.l; }
+    bool operator!=(const MclState &o) const { return !(*this == o); }
+    operator std::string() const;
 };
 
-class MclTree {
-private:
-    static struct {
-        std::size_t operator()(const MclNode *node) const
-        {
-            return (node->m << 3) | (node->c << 1) | node->l;
-        }
-    } nodeHash;
+struct MclProblem {
+    using State = MclState;
 
-    static struct {
-        bool operator()(const MclNode *n1, const MclNode *n2) const
-        {
-            return n1->m == n2->m && n1->c == n2->c && n1->l == n2->l;
-        }
-    } nodeEqual;
-
-    static struct {
-        bool operator()(const MclNode *n1, const MclNode *n2) const
-        {
-            int vh1 = n1->vh();
-            int vh2 = n2->vh();
-            if (vh1 != vh2) {
-                return vh1 > vh2;
+    State start() const { return {instance.missionaries, instance.cannibals, 0}; }
+
+    std::uint64_t key(const State &s) const
+    {
+        return (std::uint64_t(s.m) * (instance.cannibals + 1) + s.c) * 2 + s.l;
+    }
+
+    static bool isGoal(const State &s) { return s.m == 0 && s.c == 0 && s.l == 1; }
+    int heuristic(const State &s) const;
+
+    int priority(const State &s) const
+    {
+        return instance.missionaries + instance.cannibals - 2 * s.m - 2 * s.c -
+               1000 * (s.m != s.c);
+    }
+
+    static int opCount(const MclInstance &inst);
+
+    template<typename F>
+    void successors(const State &s, F &&func) const
+    {
+        const int b = instance.boat;
+        const int sign = s.l == 0 ? -1 : 1;
+        const int mside = s.l == 0 ? s.m : instance.missionaries - s.m;
+        const int cside = s.l == 0 ? s.c : instance.cannibals - s.c;
+        int o = s.l == 0 ? 0 : opCount(instance);
+
+        for (int dm = 1; dm <= b; dm++, o++) {
+            if (mside >= dm) {
+                func(State{s.m + sign * dm, s.c, 1 - s.l}, o);
             }
+        }
 
-            int d1 = n1->depth;
-            int d2 = n2->depth;
-            if (d1 != d2) {
-                return d1 < d2;
+        for (int dc = 1; dc <= b; dc++, o++) {
+            if (cside >= dc) {
+                func(State{s.m, s.c + sign * dc, 1 - s.l}, o);
             }
+        }
 
-            return n1->index < n2->index;
+        for (int dm = 1; dm < b; dm++) {
+            for (int dc = 1; dm + dc <= b; dc++, o++) {
+                if (mside >= dm && cside >= dc) {
+                    func(State{s.m + sign * dm, s.c + sign * dc, 1 - s.l}, o);
+                }
+            }
         }
-    } openCompare;
+    }
+
+    MclInstance instance;
+};
 
+using MclStrategy = SearchStrategy;
+using MclNode = SearchNode<MclProblem>;
+using MclSnapshot = SearchSnapshot<MclProblem>;
+
+class MclTree : public SearchTree<MclProblem> {
 public:
-    template<typename... Ts>
-    struct Traverse {
-        virtual ~Traverse() { }
-        virtual void operator()(Ts... args) = 0;
-    };
-
-    using Nodes = std::deque<MclNode*>;
-    using SequentialTraverse = Traverse<const MclNode*>;
-    using LevelTraverse = Traverse<const Nodes&, int>;
-
-    static bool isTarget(const MclNode *node);
-    explicit MclTree();
-    bool next();
-    bool previous();
-    bool treeContains(const MclNode *node) const;
-    Nodes pathBetween(MclNode *a, MclNode *b) const;
-    void traverse(SequentialTraverse &func) const;
-    void traverse(LevelTraverse &func) const;
-
-    MclNode *root;
-    MclNode *current;
-    std::unordered_set<MclNode*, decltype(nodeHash), decltype(nodeEqual)> uniq;
-    std::set<MclNode*, decltype(openCompare)> open;
-    Nodes closed;
+    static bool isTarget(const MclNode *node) { return MclProblem::isGoal(*node); }
+    static std::vector<std::uint64_t> recordHeader(const MclInstance &inst, MclStrategy s);
+    static bool fromRecordHeader(const std::vector<std::uint64_t> &header, MclInstance &inst,
+                                 MclStrategy &s);
+
+    explicit MclTree(const MclInstance &inst = MclInstance(),
+                     MclStrategy s = MclStrategy::Greedy)
+        : SearchTree(MclProblem{inst}, s)
+    {
+    }
 };
 
 #endif
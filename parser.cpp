@@ -1,6 +1,30 @@
 #include "parser.hpp"
 #include <cctype>
+#include <cmath>
 #include <stack>
+#include <stdexcept>
+
+std::map<std::string, PUnaryOperator> pUnaryOperatorMap = {
+    {"+", PUnaryOperator::Plus},
+    {"-", PUnaryOperator::Minus},
+    {"!", PUnaryOperator::Not},
+};
+
+std::map<std::string, std::pair<PBinaryOperator, int>> pBinaryOperatorMap = {
+    {"&", {PBinaryOperator::And, 1}},
+    {"|", {PBinaryOperator::Or, 1}},
+    {"<", {PBinaryOperator::Less, 2}},
+    {"<=", {PBinaryOperator::LessEqual, 2}},
+    {">", {PBinaryOperator::Greater, 2}},
+    {">=", {PBinaryOperator::GreaterEqual, 2}},
+    {"=", {PBinaryOperator::Equal, 2}},
+    {"!=", {PBinaryOperator::NotEqual, 2}},
+    {"+", {PBinaryOperator::Plus, 3}},
+    {"-", {PBinaryOperator::Minus, 3}},
+    {"*", {PBinaryOperator::Times, 4}},
+    {"/", {PBinaryOperator::Over, 4}},
+    {"^", {PBinaryOperator::Power, 5}}
+};
 
 enum class OperatorTestResult {
     NoMatch, PartialMatch, AmbiguousMatch, WholeMatch
@@ -137,3 +161,249 @@ std::queue<PToken> shuntingYard(const std::string &expr)
 
     return outputQueue;
 }
+
+static double applyUnary(PUnaryOperator op, double v)
+{
+    switch (op) {
+    case PUnaryOperator::Minus:
+        return -v;
+    case PUnaryOperator::Not:
+        return v == 0;
+    default:
+        return v;
+    }
+}
+
+static double applyBinary(PBinaryOperator op, double l, double r)
+{
+    switch (op) {
+    case PBinaryOperator::Plus:
+        return l + r;
+    case PBinaryOperator::Minus:
+        return l - r;
+    case PBinaryOperator::Times:
+        return l * r;
+    case PBinaryOperator::Over:
+        return l / r;
+    case PBinaryOperator::Power:
+        return std::pow(l, r);
+    case PBinaryOperator::Less:
+        return l < r;
+    case PBinaryOperator::LessEqual:
+        return l <= r;
+    case PBinaryOperator::Greater:
+        return l > r;
+    case PBinaryOperator::GreaterEqual:
+        return l >= r;
+    case PBinaryOperator::Equal:
+        return l == r;
+    case PBinaryOperator::NotEqual:
+        return l != r;
+    case PBinaryOperator::And:
+        return l != 0 && r != 0;
+    case PBinaryOperator::Or:
+        return l != 0 || r != 0;
+    }
+    return 0;
+}
+
+double pEvaluate(const PExpression &e, const PBindings &bindings)
+{
+    switch (e.type) {
+    case PNodeType::Constant:
+        return static_cast<const PConstant&>(e).value;
+    case PNodeType::Variable: {
+        const std::string &name = static_cast<const PVariable&>(e).name;
+        auto it = bindings.find(name);
+        if (it == bindings.end()) {
+            throw std::runtime_error("Unbound variable: " + name);
+        }
+        return it->second;
+    }
+    case PNodeType::UnaryOperation: {
+        const auto &u = static_cast<const PUnaryOperation&>(e);
+        return applyUnary(u.op, pEvaluate(u.arg, bindings));
+    }
+    case PNodeType::BinaryOperation: {
+        const auto &b = static_cast<const PBinaryOperation&>(e);
+        double l = pEvaluate(b.left, bindings);
+        if (b.op == PBinaryOperator::And && l == 0) {
+            return 0;
+        } else if (b.op == PBinaryOperator::Or && l != 0) {
+            return 1;
+        }
+        return applyBinary(b.op, l, pEvaluate(b.right, bindings));
+    }
+    default:
+        throw std::runtime_error("Not an expression");
+    }
+}
+
+static bool isConstant(const PExpression &e, double &value)
+{
+    if (e.type != PNodeType::Constant) {
+        return false;
+    }
+    value = static_cast<const PConstant&>(e).value;
+    return true;
+}
+
+static bool isBoolean(const PExpression &e)
+{
+    double value = 0;
+    if (isConstant(e, value)) {
+        return value == 0 || value == 1;
+    } else if (e.type == PNodeType::UnaryOperation) {
+        return static_cast<const PUnaryOperation&>(e).op == PUnaryOperator::Not;
+    } else if (e.type == PNodeType::BinaryOperation) {
+        return static_cast<const PBinaryOperation&>(e).op >= PBinaryOperator::Less;
+    }
+    return false;
+}
+
+static PExpression &constant(PProgram &out, double value, const PLocation &loc)
+{
+    PConstant &c = out.make<PConstant>(value);
+    c.loc = loc;
+    return c;
+}
+
+static PExpression &specialiseUnary(const PUnaryOperation &u, PExpression &arg, PProgram &out)
+{
+    double value = 0;
+    if (isConstant(arg, value)) {
+        return constant(out, applyUnary(u.op, value), u.loc);
+    } else if (u.op == PUnaryOperator::Plus) {
+        return arg;
+    } else if (arg.type == PNodeType::UnaryOperation) {
+        auto &inner = static_cast<PUnaryOperation&>(arg);
+        if (u.op == inner.op && (u.op == PUnaryOperator::Minus || isBoolean(inner.arg))) {
+            return inner.arg;
+        }
+    }
+
+    PUnaryOperation &result = out.make<PUnaryOperation>(u.op, arg);
+    result.loc = u.loc;
+    return result;
+}
+
+static PExpression &specialiseBinary(const PBinaryOperation &b, PExpression &l, PExpression &r,
+                                     PProgram &out)
+{
+    double lv = 0, rv = 0;
+    bool lc = isConstant(l, lv);
+    bool rc = isConstant(r, rv);
+    if (lc && rc) {
+        return constant(out, applyBinary(b.op, lv, rv), b.loc);
+    }
+
+    switch (b.op) {
+    case PBinaryOperator::And:
+    case PBinaryOperator::Or: {
+        double absorbing = b.op == PBinaryOperator::And ? 0 : 1;
+        if ((lc && (lv != 0) == absorbing) || (rc && (rv != 0) == absorbing)) {
+            return constant(out, absorbing, b.loc);
+        } else if (lc && isBoolean(r)) {
+            return r;
+        } else if (rc && isBoolean(l)) {
+            return l;
+        }
+        break;
+    }
+    case PBinaryOperator::Plus:
+        if (lc && lv == 0) {
+            return r;
+        } else if (rc && rv == 0) {
+            return l;
+        }
+        break;
+    case PBinaryOperator::Minus:
+        if (rc && rv == 0) {
+            return l;
+        } else if (lc && lv == 0) {
+            PUnaryOperation &negated = out.make<PUnaryOperation>(PUnaryOperator::Minus, r);
+            negated.loc = b.loc;
+            return negated;
+        }
+        break;
+    case PBinaryOperator::Times:
+        if ((lc && lv == 0) || (rc && rv == 0)) {
+            return constant(out, 0, b.loc);
+        } else if (lc && lv == 1) {
+            return r;
+        } else if (rc && rv == 1) {
+            return l;
+        }
+        break;
+    case PBinaryOperator::Over:
+        if (rc && rv == 1) {
+            return l;
+        }
+        break;
+    case PBinaryOperator::Power:
+        if (rc && rv == 0) {
+            return constant(out, 1, b.loc);
+        } else if (rc && rv == 1) {
+            return l;
+        }
+        break;
+    default:
+        break;
+    }
+
+    PBinaryOperation &result = out.make<PBinaryOperation>(b.op, l, r);
+    result.loc = b.loc;
+    return result;
+}
+
+static PExpression &specialise(const PExpression &e, const PBindings &known, PProgram &out)
+{
+    switch (e.type) {
+    case PNodeType::Constant:
+        return constant(out, static_cast<const PConstant&>(e).value, e.loc);
+    case PNodeType::Variable: {
+        const auto &v = static_cast<const PVariable&>(e);
+        auto it = known.find(v.name);
+        if (it != known.end()) {
+            return constant(out, it->second, e.loc);
+        }
+        PVariable &copy = out.make<PVariable>(v.name);
+        copy.loc = e.loc;
+        return copy;
+    }
+    case PNodeType::UnaryOperation: {
+        const auto &u = static_cast<const PUnaryOperation&>(e);
+        return specialiseUnary(u, specialise(u.arg, known, out), out);
+    }
+    case PNodeType::BinaryOperation: {
+        const auto &b = static_cast<const PBinaryOperation&>(e);
+        PExpression &l = specialise(b.left, known, out);
+        double lv = 0;
+        if (isConstant(l, lv) && ((b.op == PBinaryOperator::And && lv == 0) ||
+                                  (b.op == PBinaryOperator::Or && lv != 0))) {
+            return constant(out, b.op == PBinaryOperator::Or, b.loc);
+        }
+        return specialiseBinary(b, l, specialise(b.right, known, out), out);
+    }
+    default:
+        throw std::runtime_error("Not an expression");
+    }
+}
+
+PProgram pSpecialise(const PProgram &program, const PBindings &known)
+{
+    PProgram result;
+    if (program.root != nullptr) {
+        result.root = &specialise(*program.root, known, result);
+    }
+    return result;
+}
+
+const PProgram &PProgramCache::specialise(const PBindings &known)
+{
+    auto it = specialised.find(known);
+    if (it == specialised.end()) {
+        it = specialised.emplace(known, pSpecialise(program, known)).first;
+    }
+    return it->second;
+}
@@ -2,10 +2,12 @@
 #define PARSER_HPP
 
 #include <cstdlib>
+#include <memory>
 #include <string>
 #include <utility>
 #include <map>
 #include <queue>
+#include <vector>
 
 enum class PNodeType {
     Node, Expression, Constant, Variable, UnaryOperation, BinaryOperation
@@ -16,34 +18,16 @@ enum class PUnaryOperator {
 };
 
 enum class PBinaryOperator {
-    Plus, Minus, Times, Over, Power
+    Plus, Minus, Times, Over, Power,
+    Less, LessEqual, Greater, GreaterEqual, Equal, NotEqual, And, Or
 };
 
 enum class PTokenType {
     None, Invalid, Constant, Variable, Paren, Operator
 };
 
-std::map<std::string, PUnaryOperator> pUnaryOperatorMap = {
-    {"+", PUnaryOperator::Plus},
-    {"-", PUnaryOperator::Minus},
-    {"!", PUnaryOperator::Not},
-};
-
-std::map<std::string, std::pair<PBinaryOperator, int>> pBinaryOperatorMap = {
-    {"&", {PBinaryOperator::Plus, 1}},
-    {"|", {PBinaryOperator::Plus, 1}},
-    {"<", {PBinaryOperator::Plus, 2}},
-    {"<=", {PBinaryOperator::Plus, 2}},
-    {">", {PBinaryOperator::Plus, 2}},
-    {">=", {PBinaryOperator::Plus, 2}},
-    {"=", {PBinaryOperator::Plus, 2}},
-    {"!=", {PBinaryOperator::Plus, 2}},
-    {"+", {PBinaryOperator::Plus, 3}},
-    {"-", {PBinaryOperator::Minus, 3}},
-    {"*", {PBinaryOperator::Times, 4}},
-    {"/", {PBinaryOperator::Over, 4}},
-    {"^", {PBinaryOperator::Power, 5}}
-};
+extern std::map<std::string, PUnaryOperator> pUnaryOperatorMap;
+extern std::map<std::string, std::pair<PBinaryOperator, int>> pBinaryOperatorMap;
 
 struct PPosition {
     explicit PPosition() { }
@@ -134,8 +118,48 @@ struct PToken {
 };
 
 using PStringIterator = std::string::const_iterator;
+using PBindings = std::map<std::string, double>;
+
+// Owns the nodes of an expression; operations refer to their operands, so a
+// node may be shared by several parents.
+class PProgram {
+public:
+    template<typename T, typename... Args>
+    T &make(Args&&... args)
+    {
+        auto node = std::make_shared<T>(std::forward<Args>(args)...);
+        nodes.push_back(node);
+        return *node;
+    }
+
+    std::size_t size() const { return nodes.size(); }
+
+    const PExpression *root = nullptr;
+private:
+    std::vector<std::shared_ptr<PExpression>> nodes;
+};
+
+// Keeps a specialised copy of a program for every set of known bindings
+// it is asked about. Not safe to share between threads.
+class PProgramCache {
+public:
+    explicit PProgramCache(const PProgram &p) : program{p} { }
+    const PProgram &specialise(const PBindings &known);
+private:
+    PProgram program;
+    std::map<PBindings, PProgram> specialised;
+};
 
 PToken parseToken(PStringIterator &pos, const PStringIterator &end);
 std::queue<PToken> shuntingYard(const std::string &expr);
 
+// Truth values are 0 and 1; & and | skip their right operand when the left
+// one decides the result.
+double pEvaluate(const PExpression &e, const PBindings &bindings);
+
+// Replaces the known variables by constants, folds constant subexpressions
+// and drops identities (x + 0, x * 1, true & b, ...), leaving only what
+// depends on the remaining variables. Assumes values are finite.
+PProgram pSpecialise(const PProgram &program, const PBindings &known);
+
 #endif
@@ -0,0 +1,111 @@
+#include "pdb.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char magic[8] = {'M', 'C', 'L', 'P', 'D', 'B', '\0', '\1'};
+
+struct Header {
+    char magic[8];
+    std::uint64_t count;
+};
+
+}
+
+std::shared_ptr<const std::uint16_t> pdbMap(const std::string &path, std::uint64_t count)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat st;
+    std::size_t length = sizeof(Header) + count * sizeof(std::uint16_t);
+    if (::fstat(fd, &st) != 0 || std::uint64_t(st.st_size) != length) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    void *data = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+
+    const Header *header = static_cast<const Header*>(data);
+    if (std::memcmp(header->magic, magic, sizeof magic) != 0 || header->count != count) {
+        ::munmap(data, length);
+        return nullptr;
+    }
+
+    std::shared_ptr<const void> mapping(data, [length](const void *p) {
+        ::munmap(const_cast<void*>(p), length);
+    });
+    auto table = reinterpret_cast<const std::uint16_t*>(header + 1);
+    return std::shared_ptr<const std::uint16_t>(mapping, table);
+}
+
+void pdbWrite(const std::string &path, const std::uint16_t *table, std::uint64_t count)
+{
+    std::string partial = path + ".part";
+    std::FILE *file = std::fopen(partial.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("Cannot create " + partial + ": " + std::strerror(errno));
+    }
+
+    Header header;
+    std::memcpy(header.magic, magic, sizeof magic);
+    header.count = count;
+    bool ok = std::fwrite(&header, sizeof header, 1, file) == 1 &&
+              std::fwrite(table, sizeof(std::uint16_t), count, file) == count;
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok || std::rename(partial.c_str(), path.c_str()) != 0) {
+        std::string error = std::strerror(errno);
+        std::remove(partial.c_str());
+        throw std::runtime_error("Cannot write " + path + ": " + error);
+    }
+}
+
+std::string MclAbstraction::name() const
+{
+    static const char *const kinds[] = {"people", "missionaries", "cannibals"};
+    return std::string(kinds[kind]) + (splitCosts ? "-split-" : "-") +
+           std::to_string(instance.missionaries) + "x" + std::to_string(instance.cannibals) +
+           "b" + std::to_string(instance.boat);
+}
+
+bool mclPdbFromName(const std::string &name, const MclInstance &inst,
+                    const std::string &directory, MclPdbHeuristic &heuristic)
+{
+    std::vector<MclAbstraction> abstractions;
+    if (name == "people") {
+        heuristic.combine = PdbCombine::Max;
+        abstractions = {{inst, MclAbstraction::People}};
+    } else if (name == "max") {
+        heuristic.combine = PdbCombine::Max;
+        abstractions = {{inst, MclAbstraction::People}, {inst, MclAbstraction::Missionaries},
+                        {inst, MclAbstraction::Cannibals}};
+    } else if (name == "sum") {
+        heuristic.combine = PdbCombine::Sum;
+        abstractions = {{inst, MclAbstraction::Missionaries, true},
+                        {inst, MclAbstraction::Cannibals, true}};
+    } else {
+        return false;
+    }
+
+    for (const MclAbstraction &a : abstractions) {
+        if (directory.empty()) {
+            heuristic.add(PatternDatabase<MclAbstraction>(a));
+        } else {
+            heuristic.add(PatternDatabase<MclAbstraction>(a, directory));
+        }
+    }
+    return true;
+}
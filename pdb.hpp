@@ -0,0 +1,240 @@
+#ifndef PDB_HPP
+#define PDB_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "mcl.hpp"
+
+// An Abstraction maps concrete states onto a small abstract space:
+//   using State = ...;
+//   template<typename S> State project(const S &) const;
+//   std::uint64_t size() const;
+//   std::uint64_t key(const State &) const;
+//   State state(std::uint64_t key) const;
+//   template<typename F> void goals(F func) const, calling func(State)
+//   template<typename F> void predecessors(const State &, F func) const,
+//       calling func(State, cost) with a cost of 0 or 1
+//   std::string name() const, unique per abstraction and instance
+// Costs must never exceed those of the concrete moves they stand for, and
+// databases combined with PdbCombine::Sum must split every concrete move's
+// cost between them.
+
+std::shared_ptr<const std::uint16_t> pdbMap(const std::string &path, std::uint64_t count);
+void pdbWrite(const std::string &path, const std::uint16_t *table, std::uint64_t count);
+
+template<typename Abstraction>
+class PatternDatabase {
+public:
+    static constexpr std::uint16_t const unreachable = 0xffff;
+
+    explicit PatternDatabase(const Abstraction &a) : abstraction(a)
+    {
+        auto owned = std::make_shared<std::vector<std::uint16_t>>(build());
+        table = std::shared_ptr<const std::uint16_t>(owned, owned->data());
+    }
+
+    PatternDatabase(const Abstraction &a, const std::string &directory) : abstraction(a)
+    {
+        std::string path = directory + "/" + abstraction.name() + ".pdb";
+        table = pdbMap(path, abstraction.size());
+        if (!table) {
+            std::vector<std::uint16_t> built = build();
+            pdbWrite(path, built.data(), built.size());
+            table = pdbMap(path, abstraction.size());
+        }
+    }
+
+    template<typename S>
+    int operator()(const S &s) const
+    {
+        std::uint16_t d = table.get()[abstraction.key(abstraction.project(s))];
+        return d == unreachable ? 1 << 20 : d;
+    }
+
+    std::size_t bytes() const { return abstraction.size() * sizeof(std::uint16_t); }
+
+    Abstraction abstraction;
+private:
+    std::vector<std::uint16_t> build() const
+    {
+        MCL_TRACE_SPAN("PatternDatabase::build");
+        std::vector<std::uint16_t> distance(abstraction.size(), unreachable);
+        std::deque<std::uint64_t> queue;
+        abstraction.goals([&](const typename Abstraction::State &s) {
+            std::uint64_t k = abstraction.key(s);
+            if (distance[k] != 0) {
+                distance[k] = 0;
+                queue.push_back(k);
+            }
+        });
+
+        while (!queue.empty()) {
+            std::uint64_t k = queue.front();
+            queue.pop_front();
+            int d = distance[k];
+            abstraction.predecessors(abstraction.state(k),
+                                     [&](const typename Abstraction::State &s, int cost) {
+                std::uint64_t p = abstraction.key(s);
+                int dp = std::min(d + cost, unreachable - 1);
+                if (dp < distance[p]) {
+                    distance[p] = dp;
+                    if (cost == 0) {
+                        queue.push_front(p);
+                    } else {
+                        queue.push_back(p);
+                    }
+                }
+            });
+        }
+        return distance;
+    }
+
+    std::shared_ptr<const std::uint16_t> table;
+};
+
+template<typename Abstraction>
+constexpr std::uint16_t const PatternDatabase<Abstraction>::unreachable;
+
+enum class PdbCombine {
+    Max, Sum
+};
+
+template<typename Abstraction>
+class PdbHeuristic {
+public:
+    explicit PdbHeuristic(PdbCombine c = PdbCombine::Max) : combine{c} { }
+
+    void add(const PatternDatabase<Abstraction> &db) { databases.push_back(db); }
+    bool empty() const { return databases.empty(); }
+
+    template<typename S>
+    int operator()(const S &s) const
+    {
+        int h = 0;
+        for (const auto &db : databases) {
+            h = combine == PdbCombine::Sum ? h + db(s) : std::max(h, db(s));
+        }
+        return h;
+    }
+
+    std::size_t bytes() const
+    {
+        std::size_t total = 0;
+        for (const auto &db : databases) {
+            total += db.bytes();
+        }
+        return total;
+    }
+
+    PdbCombine combine;
+    std::vector<PatternDatabase<Abstraction>> databases;
+};
+
+// Keeps the problem's own bound, so adding databases never weakens it.
+template<typename Problem, typename Heuristic>
+struct PdbProblem : Problem {
+    using State = typename Problem::State;
+
+    PdbProblem() = default;
+    PdbProblem(const Problem &p, const Heuristic &h) : Problem(p), pdb(h) { }
+
+    int heuristic(const State &s) const { return std::max(Problem::heuristic(s), pdb(s)); }
+
+    Heuristic pdb;
+};
+
+// Abstracts (m, c, l) to (k, l) where k counts either everyone (the kinds are
+// merged) or only one kind (the other is projected out and assumed to be
+// wherever a rower is needed). With split costs a crossing is charged to the
+// missionary projection when it carries a missionary and to the cannibal
+// projection when the boat is full of cannibals, so the two can be added.
+struct MclAbstraction {
+    enum Kind {
+        People, Missionaries, Cannibals
+    };
+
+    struct State {
+        int k;
+        int l;
+    };
+
+    MclAbstraction() = default;
+    MclAbstraction(const MclInstance &inst, Kind k, bool split = false)
+        : instance(inst), kind{k}, splitCosts{split}
+    {
+    }
+
+    template<typename S>
+    State project(const S &s) const
+    {
+        switch (kind) {
+        case Missionaries:
+            return {s.m, s.l};
+        case Cannibals:
+            return {s.c, s.l};
+        default:
+            return {s.m + s.c, s.l};
+        }
+    }
+
+    int kept() const
+    {
+        switch (kind) {
+        case Missionaries:
+            return instance.missionaries;
+        case Cannibals:
+            return instance.cannibals;
+        default:
+            return instance.missionaries + instance.cannibals;
+        }
+    }
+
+    int others() const { return instance.missionaries + instance.cannibals - kept(); }
+    std::uint64_t size() const { return (std::uint64_t(kept()) + 1) * 2; }
+    std::uint64_t key(const State &s) const { return std::uint64_t(s.k) * 2 + s.l; }
+    State state(std::uint64_t key) const { return {int(key / 2), int(key % 2)}; }
+
+    template<typename F>
+    void goals(F &&func) const
+    {
+        func(State{0, 1});
+    }
+
+    template<typename F>
+    void predecessors(const State &s, F &&func) const
+    {
+        const int b = instance.boat;
+        const int sign = s.l == 0 ? -1 : 1;
+        const int side = s.l == 0 ? s.k : kept() - s.k;
+        for (int d = others() > 0 ? 0 : 1; d <= b && d <= side; d++) {
+            func(State{s.k + sign * d, 1 - s.l}, cost(d));
+        }
+    }
+
+    int cost(int d) const
+    {
+        if (!splitCosts || kind == People) {
+            return 1;
+        }
+        return kind == Missionaries ? d > 0 : d == instance.boat;
+    }
+
+    std::string name() const;
+
+    MclInstance instance;
+    Kind kind = People;
+    bool splitCosts = false;
+};
+
+using MclPdbHeuristic = PdbHeuristic<MclAbstraction>;
+using MclPdbProblem = PdbProblem<MclProblem, MclPdbHeuristic>;
+
+bool mclPdbFromName(const std::string &name, const MclInstance &inst,
+                    const std::string &directory, MclPdbHeuristic &heuristic);
+
+#endif
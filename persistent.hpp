@@ -0,0 +1,129 @@
+#ifndef PERSISTENT_HPP
+#define PERSISTENT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Copies share their chunks and are frozen versions of the vector. Copying
+// starts a new generation on both sides; a writer changes the directory or
+// a chunk in place only if it was made in its current generation, and
+// clones it otherwise, so reference counts are never consulted.
+template<typename T, std::size_t ChunkBits = 8>
+class PersistentVector {
+public:
+    static constexpr std::size_t const chunkSize = std::size_t(1) << ChunkBits;
+
+    PersistentVector() = default;
+
+    PersistentVector(const PersistentVector &other)
+        : chunks{other.chunks}, directoryGeneration{other.directoryGeneration},
+          count{other.count}
+    {
+        other.generation.store(nextGeneration(), std::memory_order_relaxed);
+    }
+
+    PersistentVector(PersistentVector &&other)
+        : chunks{std::move(other.chunks)}, directoryGeneration{other.directoryGeneration},
+          generation{other.generation.load(std::memory_order_relaxed)}, count{other.count}
+    {
+        other.count = 0;
+        other.generation.store(nextGeneration(), std::memory_order_relaxed);
+    }
+
+    PersistentVector &operator=(const PersistentVector &other)
+    {
+        if (this != &other) {
+            chunks = other.chunks;
+            directoryGeneration = other.directoryGeneration;
+            count = other.count;
+            generation.store(nextGeneration(), std::memory_order_relaxed);
+            other.generation.store(nextGeneration(), std::memory_order_relaxed);
+        }
+        return *this;
+    }
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    const T &operator[](std::size_t i) const
+    {
+        return (*(*chunks)[i >> ChunkBits].chunk)[i & (chunkSize - 1)];
+    }
+
+    const T &back() const { return (*this)[count - 1]; }
+
+    T &edit(std::size_t i)
+    {
+        return ownChunk(i >> ChunkBits)[i & (chunkSize - 1)];
+    }
+
+    void push_back(const T &value)
+    {
+        if ((count & (chunkSize - 1)) == 0) {
+            ownDirectory();
+            chunks->push_back({std::make_shared<Chunk>(), current()});
+            chunks->back().chunk->reserve(chunkSize);
+        }
+        ownChunk(count >> ChunkBits).push_back(value);
+        count++;
+    }
+
+    void pop_back()
+    {
+        count--;
+        ownChunk(count >> ChunkBits).pop_back();
+        if ((count & (chunkSize - 1)) == 0) {
+            chunks->pop_back();
+        }
+    }
+private:
+    using Chunk = std::vector<T>;
+
+    struct Entry {
+        std::shared_ptr<Chunk> chunk;
+        std::uint64_t generation;
+    };
+
+    using Directory = std::vector<Entry>;
+
+    static std::uint64_t nextGeneration()
+    {
+        static std::atomic<std::uint64_t> last{0};
+        return last.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    std::uint64_t current() const { return generation.load(std::memory_order_relaxed); }
+
+    void ownDirectory()
+    {
+        if (!chunks) {
+            chunks = std::make_shared<Directory>();
+        } else if (directoryGeneration != current()) {
+            chunks = std::make_shared<Directory>(*chunks);
+        }
+        directoryGeneration = current();
+    }
+
+    Chunk &ownChunk(std::size_t index)
+    {
+        ownDirectory();
+        Entry &entry = (*chunks)[index];
+        if (entry.generation != current()) {
+            auto copy = std::make_shared<Chunk>();
+            copy->reserve(chunkSize);
+            copy->assign(entry.chunk->cbegin(), entry.chunk->cend());
+            entry = {copy, current()};
+        }
+        return *entry.chunk;
+    }
+
+    std::shared_ptr<Directory> chunks;
+    std::uint64_t directoryGeneration = 0;
+    mutable std::atomic<std::uint64_t> generation{nextGeneration()};
+    std::size_t count = 0;
+};
+
+#endif
@@ -1,15 +1,27 @@
 TEMPLATE = app
 TARGET = app
 
-QT = core gui svg
+QT = core gui svg concurrent network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
-CONFIG += qt debug release
-HEADERS += MclWindow.hpp LabelRow.hpp MclWidget.hpp mcl.hpp parser.hpp
-SOURCES += main.cpp MclWindow.cpp LabelRow.cpp MclWidget.cpp mcl.cpp parser.cpp
+CONFIG += qt debug release stats
+LIBS += -lz
 
-latexsvg.commands = @make -C latex
+stats: DEFINES += MCL_STATS
+
+HEADERS += MclWindow.hpp LabelRow.hpp MclWidget.hpp TileCache.hpp TreeExporter.hpp FormulaCache.hpp StatsPanel.hpp SolverDaemon.hpp mcl.hpp searchtree.hpp searchview.hpp recorder.hpp pdb.hpp groups.hpp persistent.hpp search.hpp stats.hpp trace.hpp parser.hpp
+SOURCES += main.cpp MclWindow.cpp LabelRow.cpp MclWidget.cpp TileCache.cpp TreeExporter.cpp FormulaCache.cpp StatsPanel.cpp SolverDaemon.cpp mcl.cpp bidirectional.cpp external.cpp solutions.cpp bounded.cpp pdb.cpp groups.cpp recorder.cpp stats.cpp trace.cpp parser.cpp
+# The formulas, their manifest and the .qrc listing them are generated in
+# the build directory; rcc depends on the .qrc, which is refreshed first.
+FORMULAS = $$OUT_PWD/latex/formulas.qrc
+RESOURCES += $$FORMULAS
+
+latexsvg.target = $$FORMULAS
+latexsvg.commands = @$$PWD/latex/formulas.sh $$OUT_PWD/latex
+latexsvg.depends = FORCE
 
 QMAKE_EXTRA_TARGETS += latexsvg
-PRE_TARGETDEPS += latexsvg
+
+bench.commands = @mkdir -p bench && cd bench && $(QMAKE) $$PWD/bench/bench.pro && $(MAKE)
+QMAKE_EXTRA_TARGETS += bench
@@ -0,0 +1,149 @@
+#include "recorder.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const char magic[8] = {'M', 'C', 'L', 'R', 'E', 'C', '\0', '\1'};
+
+class RecorderError : public std::runtime_error {
+public:
+    explicit RecorderError(const std::string &what, const std::string &path)
+        : std::runtime_error(what + " " + path + ": " + std::strerror(errno))
+    {
+    }
+};
+
+void writeVarint(std::vector<unsigned char> &buffer, std::uint64_t value)
+{
+    for (; value >= 0x80; value >>= 7) {
+        buffer.push_back(static_cast<unsigned char>(value | 0x80));
+    }
+    buffer.push_back(static_cast<unsigned char>(value));
+}
+
+const unsigned char *readVarint(const unsigned char *p, const unsigned char *end,
+                                std::uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; p != end && shift < 64; shift += 7) {
+        unsigned char byte = *p++;
+        value |= std::uint64_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+}
+
+SearchRecorder::SearchRecorder(const std::string &p, const std::vector<std::uint64_t> &header)
+    : path{p}
+{
+    file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        throw RecorderError("Cannot create", path);
+    }
+
+    buffer.reserve(flushSize + 16);
+    buffer.insert(buffer.end(), magic, magic + sizeof magic);
+    writeVarint(buffer, header.size());
+    for (std::uint64_t value : header) {
+        writeVarint(buffer, value);
+    }
+}
+
+SearchRecorder::~SearchRecorder()
+{
+    if (file != nullptr) {
+        std::fwrite(buffer.data(), 1, buffer.size(), file);
+        std::fclose(file);
+    }
+}
+
+void SearchRecorder::flush()
+{
+    if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+        throw RecorderError("Cannot write", path);
+    }
+    buffer.clear();
+}
+
+void SearchRecorder::close()
+{
+    flush();
+    if (std::fclose(file) != 0) {
+        file = nullptr;
+        throw RecorderError("Cannot write", path);
+    }
+    file = nullptr;
+}
+
+SearchLog::SearchLog(const std::string &path)
+{
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        throw RecorderError("Cannot open", path);
+    }
+
+    unsigned char chunk[1 << 16];
+    for (std::size_t n; (n = std::fread(chunk, 1, sizeof chunk, file)) > 0; ) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    bool failed = std::ferror(file) != 0;
+    std::fclose(file);
+    if (failed) {
+        throw RecorderError("Cannot read", path);
+    }
+
+    const unsigned char *begin = data.data();
+    const unsigned char *end = begin + data.size();
+    if (data.size() < sizeof magic || std::memcmp(begin, magic, sizeof magic) != 0) {
+        throw std::runtime_error("Not a search recording: " + path);
+    }
+
+    std::uint64_t n;
+    const unsigned char *p = readVarint(begin + sizeof magic, end, n);
+    for (std::uint64_t i = 0; p != nullptr && i < n; i++) {
+        std::uint64_t value;
+        p = readVarint(p, end, value);
+        header.push_back(value);
+    }
+    if (p == nullptr) {
+        throw std::runtime_error("Truncated search recording: " + path);
+    }
+
+    for (SearchEvent e; p != end; count++) {
+        if (count % indexStride == 0) {
+            offsets.push_back(p - begin);
+        }
+
+        p = decode(p, end, e);
+        if (p == nullptr) {
+            throw std::runtime_error("Truncated search recording: " + path);
+        }
+    }
+}
+
+const unsigned char *SearchLog::decode(const unsigned char *p, const unsigned char *end,
+                                       SearchEvent &e)
+{
+    std::uint64_t v;
+    p = readVarint(p, end, v);
+    e.type = static_cast<SearchEvent::Type>(v & ((1 << SearchEvent::typeBits) - 1));
+    e.value = v >> SearchEvent::typeBits;
+    return p;
+}
+
+SearchEvent SearchLog::event(std::uint64_t index) const
+{
+    const unsigned char *p = data.data() + offsets[index / indexStride];
+    const unsigned char *end = data.data() + data.size();
+    SearchEvent e;
+    for (std::uint64_t i = index - index % indexStride; i <= index; i++) {
+        p = decode(p, end, e);
+    }
+    return e;
+}
@@ -0,0 +1,211 @@
+#ifndef RECORDER_HPP
+#define RECORDER_HPP
+
+#include <cstdint>
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct SearchEvent {
+    enum Type {
+        Next, Previous, Expand, Duplicate, Pop, Supersede
+    };
+
+    static constexpr int const typeBits = 3;
+
+    Type type;
+    std::uint64_t value;
+};
+
+// Events are LEB128 varints of (value << typeBits | type) after a header of
+// magic bytes and varint parameters describing the search.
+class SearchRecorder {
+public:
+    explicit SearchRecorder(const std::string &path, const std::vector<std::uint64_t> &header);
+    ~SearchRecorder();
+    SearchRecorder(const SearchRecorder&) = delete;
+    SearchRecorder &operator=(const SearchRecorder&) = delete;
+
+    void record(SearchEvent::Type type, std::uint64_t value = 0)
+    {
+        std::uint64_t v = value << SearchEvent::typeBits | type;
+        while (v >= 0x80) {
+            buffer.push_back(static_cast<unsigned char>(v | 0x80));
+            v >>= 7;
+        }
+        buffer.push_back(static_cast<unsigned char>(v));
+        count++;
+        if (buffer.size() >= flushSize) {
+            flush();
+        }
+    }
+
+    std::uint64_t events() const { return count; }
+    void close();
+private:
+    static constexpr std::size_t const flushSize = 1 << 16;
+
+    void flush();
+
+    std::string path;
+    std::FILE *file;
+    std::vector<unsigned char> buffer;
+    std::uint64_t count = 0;
+};
+
+// Keeps a recorded log in memory with the byte offset of every
+// indexStride-th event, so decoding can start near any position.
+class SearchLog {
+public:
+    static constexpr std::uint64_t const indexStride = 1024;
+
+    explicit SearchLog(const std::string &path);
+    std::uint64_t size() const { return count; }
+    SearchEvent event(std::uint64_t index) const;
+
+    template<typename F>
+    void forEach(std::uint64_t from, std::uint64_t to, F &&func) const
+    {
+        if (from >= to) {
+            return;
+        }
+
+        const unsigned char *p = data.data() + offsets[from / indexStride];
+        const unsigned char *end = data.data() + data.size();
+        SearchEvent e;
+        for (std::uint64_t i = from - from % indexStride; i < to; i++) {
+            p = decode(p, end, e);
+            if (i >= from) {
+                func(e);
+            }
+        }
+    }
+
+    std::vector<std::uint64_t> header;
+private:
+    static const unsigned char *decode(const unsigned char *p, const unsigned char *end,
+                                       SearchEvent &e);
+
+    std::vector<unsigned char> data;
+    std::uint64_t count = 0;
+    std::vector<std::size_t> offsets;
+};
+
+// Drives a tree through a log, taking the popped nodes from the log rather
+// than from the open list. Undoing a step is not exact for every strategy,
+// so seeking backwards restarts from the nearest copy of the tree, kept every
+// checkpointEvents events. prepare() lays down all the copies on a scratch
+// tree and may run on another thread before the first seek().
+template<typename Tree>
+class SearchReplay {
+public:
+    static constexpr std::uint64_t const checkpointEvents = 1 << 14;
+
+    explicit SearchReplay(const SearchLog &l, Tree &t) : log(l), tree(t)
+    {
+        checkpoints.push_back({0, std::unique_ptr<Tree>(new Tree(tree))});
+    }
+
+    std::uint64_t position() const { return cursor.position; }
+    std::uint64_t divergent() const { return mismatches; }
+
+    void prepare()
+    {
+        Tree scratch(*checkpoints.back().tree);
+        Cursor c{checkpoints.back().position, false};
+        run(scratch, c, log.size());
+    }
+
+    void seek(std::uint64_t target)
+    {
+        target = std::min(target, log.size());
+        if (target < cursor.position || target - cursor.position > checkpointEvents) {
+            auto it = std::upper_bound(checkpoints.cbegin(), checkpoints.cend(), target,
+                                       [](std::uint64_t t, const Checkpoint &c) {
+                return t < c.position;
+            }) - 1;
+            if (target < cursor.position || it->position > cursor.position) {
+                tree = *it->tree;
+                cursor = {it->position, false};
+            }
+        }
+        run(tree, cursor, target);
+    }
+private:
+    struct Checkpoint {
+        std::uint64_t position;
+        std::unique_ptr<Tree> tree;
+    };
+
+    struct Cursor {
+        std::uint64_t position;
+        bool pending;
+    };
+
+    void run(Tree &t, Cursor &c, std::uint64_t target)
+    {
+        log.forEach(c.position, target, [&](const SearchEvent &e) {
+            c.position++;
+            apply(t, c, e);
+        });
+
+        if (c.pending && (c.position == log.size() ||
+                          log.event(c.position).type == SearchEvent::Next ||
+                          log.event(c.position).type == SearchEvent::Previous)) {
+            finishNext(t, c);
+        }
+    }
+
+    void apply(Tree &t, Cursor &c, const SearchEvent &e)
+    {
+        switch (e.type) {
+        case SearchEvent::Next:
+            finishNext(t, c);
+            c.pending = true;
+            break;
+        case SearchEvent::Pop:
+            if (!t.next(std::uint32_t(e.value)) && c.position > furthest) {
+                mismatches++;
+            }
+            c.pending = false;
+            checkpoint(t, c);
+            break;
+        case SearchEvent::Previous:
+            finishNext(t, c);
+            t.previous();
+            checkpoint(t, c);
+            break;
+        default:
+            break;
+        }
+        furthest = std::max(furthest, c.position);
+    }
+
+    // A next() that popped nothing leaves the tree as it was, but repeating
+    // it keeps the statistics in step with the recorded search.
+    static void finishNext(Tree &t, Cursor &c)
+    {
+        if (c.pending) {
+            t.next();
+            c.pending = false;
+        }
+    }
+
+    void checkpoint(const Tree &t, const Cursor &c)
+    {
+        if (c.position >= checkpoints.back().position + checkpointEvents) {
+            checkpoints.push_back({c.position, std::unique_ptr<Tree>(new Tree(t))});
+        }
+    }
+
+    const SearchLog &log;
+    Tree &tree;
+    Cursor cursor{0, false};
+    std::uint64_t furthest = 0;
+    std::uint64_t mismatches = 0;
+    std::vector<Checkpoint> checkpoints;
+};
+
+#endif
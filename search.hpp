@@ -0,0 +1,202 @@
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "mcl.hpp"
+
+using MclPath = std::vector<MclState>;
+
+struct MclSearchResult {
+    MclPath path;
+    std::uint64_t expanded = 0;
+    std::uint64_t generated = 0;
+};
+
+class MclBigUint {
+public:
+    MclBigUint(std::uint32_t value = 0);
+    static bool fromString(const std::string &text, MclBigUint &value);
+    bool isZero() const { return limbs.empty(); }
+    MclBigUint &operator+=(const MclBigUint &other);
+    MclBigUint &operator-=(const MclBigUint &other);
+    bool operator<(const MclBigUint &other) const;
+    operator std::string() const;
+private:
+    static constexpr std::uint32_t const base = 1000000000;
+    std::vector<std::uint32_t> limbs;
+};
+
+class MclMemoryQuota;
+
+struct MclExternalOptions {
+    std::string directory;
+    std::size_t memoryBudget = std::size_t(64) << 20;
+    MclMemoryQuota *quota = nullptr;
+};
+
+struct MclExternalResult : MclSearchResult {
+    std::vector<std::uint64_t> layers;
+    std::uint64_t bytesRead = 0;
+    std::uint64_t bytesWritten = 0;
+    std::uint64_t runs = 0;
+    std::size_t residentBytes = 0;
+};
+
+class MclMemoryQuota {
+public:
+    explicit MclMemoryQuota(std::size_t bytes) : limit{bytes} { }
+    bool acquire(std::size_t bytes);
+    void release(std::size_t bytes) { used_.fetch_sub(bytes, std::memory_order_relaxed); }
+    std::size_t used() const { return used_.load(std::memory_order_relaxed); }
+
+    const std::size_t limit;
+private:
+    std::atomic<std::size_t> used_{0};
+};
+
+// Holds bytes of a quota, if any, for as long as it lives.
+class MclQuotaReservation {
+public:
+    MclQuotaReservation(MclMemoryQuota *q, std::size_t b) : quota{q}, bytes{b}
+    {
+        if (quota != nullptr && !quota->acquire(bytes)) {
+            throw std::runtime_error("Memory quota exhausted");
+        }
+    }
+
+    ~MclQuotaReservation()
+    {
+        if (quota != nullptr) {
+            quota->release(bytes);
+        }
+    }
+
+    MclQuotaReservation(const MclQuotaReservation&) = delete;
+    MclQuotaReservation &operator=(const MclQuotaReservation&) = delete;
+private:
+    MclMemoryQuota *quota;
+    std::size_t bytes;
+};
+
+enum class MclBoundedMode { SMAStar, Beam };
+
+struct MclBoundedOptions {
+    MclBoundedMode mode = MclBoundedMode::SMAStar;
+    std::size_t maxNodes = 1 << 16;
+    std::size_t maxBytes = 0;
+    std::size_t beamWidth = 0;
+    MclMemoryQuota *quota = nullptr;
+};
+
+// lowerBound is -1 when nothing bounds the solution: the instance has none
+// or every path left open was cut off by the memory limit.
+struct MclBoundedResult : MclSearchResult {
+    int lowerBound = 0;
+    std::uint64_t pruned = 0;
+    std::size_t peakNodes = 0;
+    std::size_t bytesPerNode = 0;
+    // The shared quota, not the search's own limits, held it back, so
+    // another run under less load may do better.
+    bool quotaLimited = false;
+
+    int gap() const
+    {
+        return path.empty() || lowerBound < 0 ? -1 : int(path.size()) - 1 - lowerBound;
+    }
+};
+
+class MclSpace {
+public:
+    explicit MclSpace(const MclInstance &inst)
+        : MclSpace(inst, {inst.missionaries, inst.cannibals, 0})
+    {
+    }
+
+    MclSpace(const MclInstance &inst, const MclState &from)
+        : instance(inst), origin(from), problem{inst}
+    {
+    }
+
+    MclState start() const { return origin; }
+    static MclState goal() { return {0, 0, 1}; }
+
+    bool contains(const MclState &s) const
+    {
+        return s.m >= 0 && s.m <= instance.missionaries && s.c >= 0 &&
+               s.c <= instance.cannibals && (s.l == 0 || s.l == 1);
+    }
+
+    std::uint64_t size() const
+    {
+        return std::uint64_t(instance.missionaries + 1) * (instance.cannibals + 1) * 2;
+    }
+
+    std::uint64_t key(const MclState &s) const { return problem.key(s); }
+
+    // Inverse of MclProblem::key().
+    MclState state(std::uint64_t key) const
+    {
+        int l = key % 2;
+        key /= 2;
+        return {int(key / (instance.cannibals + 1)), int(key % (instance.cannibals + 1)), l};
+    }
+
+    int heuristic(const MclState &s) const { return problem.heuristic(s); }
+
+    template<typename F>
+    void successors(const MclState &s, F &&func) const
+    {
+        problem.successors(s, [&func](const MclState &next, int) { func(next); });
+    }
+
+    template<typename F>
+    void predecessors(const MclState &s, F &&func) const
+    {
+        // Carrying the same people back undoes any move.
+        successors(s, std::forward<F>(func));
+    }
+
+    const MclInstance instance;
+    const MclState origin;
+    const MclProblem problem;
+};
+
+class MclSolutions {
+public:
+    explicit MclSolutions(const MclInstance &inst);
+    bool solvable() const { return length_ >= 0; }
+    int length() const { return length_; }
+    const MclBigUint &count() const;
+    MclPath at(MclBigUint index) const;
+    bool next(MclPath &path);
+    void rewind();
+private:
+    struct Frame {
+        std::uint64_t key;
+        std::size_t branch;
+    };
+
+    std::vector<std::uint64_t> layerSuccessors(std::uint64_t key) const;
+    bool descend(std::size_t branch);
+
+    MclSpace space;
+    int length_ = -1;
+    std::vector<int> dist;
+    std::vector<MclBigUint> counts;
+    std::vector<Frame> stack;
+    bool started = false;
+};
+
+MclSearchResult bidirectionalSearch(const MclInstance &inst);
+MclSearchResult bidirectionalSearch(const MclSpace &space, MclMemoryQuota *quota = nullptr);
+MclExternalResult externalSearch(const MclInstance &inst, const MclExternalOptions &options);
+MclExternalResult externalSearch(const MclSpace &space, const MclExternalOptions &options);
+MclBoundedResult boundedSearch(const MclInstance &inst, const MclBoundedOptions &options);
+MclBoundedResult boundedSearch(const MclSpace &space, const MclBoundedOptions &options);
+
+#endif
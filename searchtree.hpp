@@ -0,0 +1,792 @@
+#ifndef SEARCHTREE_HPP
+#define SEARCHTREE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "persistent.hpp"
+#include "recorder.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+
+// A Problem supplies:
+//   using State = ...;                        copyable, used as a base of the nodes
+//   State start() const;
+//   std::uint64_t key(const State &) const;   unique per state
+//   bool isGoal(const State &) const;
+//   int heuristic(const State &) const;       admissible, for A*
+//   void successors(const State &, F func) const, calling func(State, op)
+// and optionally int priority(const State &) const for the greedy strategy,
+// which otherwise expands the state with the lowest heuristic first.
+
+enum class SearchStrategy {
+    Greedy, AStar
+};
+
+template<typename Problem, typename = void>
+struct SearchPriority {
+    static int get(const Problem &p, const typename Problem::State &s) { return -p.heuristic(s); }
+};
+
+template<typename Problem>
+struct SearchPriority<Problem, decltype(void(std::declval<const Problem&>().priority(
+                                   std::declval<const typename Problem::State&>())))> {
+    static int get(const Problem &p, const typename Problem::State &s) { return p.priority(s); }
+};
+
+template<typename Problem>
+class SearchNode : public Problem::State {
+public:
+    using State = typename Problem::State;
+
+    explicit SearchNode(const State &s, SearchNode *p, int d, int i, int o = -1)
+        : State(s), parent{p}, depth{d}, index{i}, op{o}, ccount{-1}, problem{p->problem}
+    {
+    }
+
+    explicit SearchNode(const State &s, const Problem *pr)
+        : State(s), parent{nullptr}, depth{0}, index{-1}, op{-1}, ccount{-1}, problem{pr}
+    {
+    }
+
+    const State &state() const { return *this; }
+    std::uint64_t key() const { return problem->key(*this); }
+    int h() const { return problem->heuristic(*this); }
+    int f() const { return depth + h(); }
+    int priority() const { return SearchPriority<Problem>::get(*problem, *this); }
+
+    int iterate()
+    {
+        MCL_TRACE_SPAN("SearchNode::iterate");
+        if (ccount != -1) {
+            return -1;
+        }
+
+        ccount = 0;
+        problem->successors(state(), [this](const State &s, int o) {
+            children.emplace_back(new SearchNode(s, this, depth + 1, ccount++, o));
+        });
+        return ccount;
+    }
+
+    void uniterate()
+    {
+        if (ccount == -1) {
+            return;
+        }
+
+        children.clear();
+        ccount = -1;
+    }
+
+    SearchNode *parent;
+    int depth;
+    int index;
+    int op;
+    int ccount;
+    std::uint32_t id = 0;
+    const Problem *problem;
+    std::vector<std::unique_ptr<SearchNode>> children;
+};
+
+template<typename Problem>
+class SearchSnapshot {
+public:
+    using State = typename Problem::State;
+
+    struct Node : State {
+        int depth;
+        int op;
+        int ccount;
+        std::uint32_t parent;
+        std::uint32_t firstChild;
+        bool inTree;
+        bool open;
+    };
+
+    static constexpr std::uint32_t const none = std::uint32_t(-1);
+
+    explicit SearchSnapshot(const Problem &p = Problem(),
+                            SearchStrategy s = SearchStrategy::Greedy)
+        : problem(p), strategy{s}
+    {
+    }
+
+    std::size_t size() const { return nodes.size(); }
+    const Node &operator[](std::uint32_t id) const { return nodes[id]; }
+    std::uint32_t root() const { return 0; }
+    std::uint32_t current() const { return closed.back(); }
+
+    std::vector<std::uint32_t> pathTo(std::uint32_t id) const
+    {
+        std::vector<std::uint32_t> path;
+        for (; id != none; id = nodes[id].parent) {
+            path.push_back(id);
+        }
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+
+    std::vector<std::uint32_t> openNodes() const
+    {
+        std::vector<std::uint32_t> ids;
+        for (std::uint32_t id = 0; id < nodes.size(); id++) {
+            if (nodes[id].open) {
+                ids.push_back(id);
+            }
+        }
+        return ids;
+    }
+
+    std::vector<std::uint32_t> closedNodes() const
+    {
+        std::vector<std::uint32_t> ids;
+        ids.reserve(closed.size());
+        for (std::size_t i = 0; i < closed.size(); i++) {
+            ids.push_back(closed[i]);
+        }
+        return ids;
+    }
+
+    template<typename F>
+    void traverse(F &&func) const
+    {
+        std::vector<std::uint32_t> level = {root()};
+        while (!level.empty()) {
+            std::vector<std::uint32_t> next;
+            for (std::uint32_t id : level) {
+                const Node &node = nodes[id];
+                func(id, node);
+                for (int i = 0; i < node.ccount; i++) {
+                    if (nodes[node.firstChild + i].inTree) {
+                        next.push_back(node.firstChild + i);
+                    }
+                }
+            }
+            level.swap(next);
+        }
+    }
+
+    Problem problem;
+    SearchStrategy strategy;
+    std::uint64_t version = 0;
+    MclStats stats;
+private:
+    template<typename> friend class SearchTree;
+
+    PersistentVector<Node> nodes;
+    PersistentVector<std::uint32_t> closed;
+};
+
+template<typename Problem>
+constexpr std::uint32_t const SearchSnapshot<Problem>::none;
+
+template<typename Problem>
+class SearchTree {
+public:
+    using State = typename Problem::State;
+    using Node = SearchNode<Problem>;
+    using Snapshot = SearchSnapshot<Problem>;
+private:
+    struct NodeHash {
+        std::size_t operator()(const Node *node) const
+        {
+            return std::hash<std::uint64_t>()(node->key());
+        }
+    };
+
+    struct NodeEqual {
+        bool operator()(const Node *n1, const Node *n2) const
+        {
+            return n1->key() == n2->key();
+        }
+    };
+
+    struct OpenCompare {
+        bool operator()(const Node *n1, const Node *n2) const
+        {
+            if (strategy == SearchStrategy::AStar) {
+                return aStarLess(n1, n2);
+            }
+
+            int p1 = n1->priority();
+            int p2 = n2->priority();
+            if (p1 != p2) {
+                return p1 > p2;
+            }
+
+            int d1 = n1->depth;
+            int d2 = n2->depth;
+            if (d1 != d2) {
+                return d1 < d2;
+            }
+
+            return n1->index < n2->index;
+        }
+
+        static bool aStarLess(const Node *n1, const Node *n2)
+        {
+            int f1 = n1->f();
+            int f2 = n2->f();
+            if (f1 != f2) {
+                return f1 < f2;
+            }
+
+            if (n1->depth != n2->depth) {
+                return n1->depth > n2->depth;
+            }
+
+            return n1->key() < n2->key();
+        }
+
+        SearchStrategy strategy = SearchStrategy::Greedy;
+    };
+
+public:
+    template<typename... Ts>
+    struct Traverse {
+        virtual ~Traverse() { }
+        virtual void operator()(Ts... args) = 0;
+    };
+
+    using Nodes = std::deque<Node*>;
+    using SequentialTraverse = Traverse<const Node*>;
+    using LevelTraverse = Traverse<const Nodes&, int>;
+
+    struct Level {
+        Node *const *begin() const { return first; }
+        Node *const *end() const { return last; }
+        std::size_t size() const { return last - first; }
+        Node *operator[](std::size_t i) const { return first[i]; }
+
+        Node *const *first;
+        Node *const *last;
+    };
+
+    static bool strategyFromName(const std::string &name, SearchStrategy &strategy);
+    static const char *strategyName(SearchStrategy strategy);
+    explicit SearchTree(const Problem &p, SearchStrategy s = SearchStrategy::Greedy);
+    SearchTree(const SearchTree &other);
+    ~SearchTree() { delete root; }
+    SearchTree &operator=(const SearchTree &other);
+    bool isTarget(const Node *node) const { return problem.isGoal(*node); }
+    bool next() { return step(Snapshot::none); }
+    bool next(std::uint32_t pop) { return pop != Snapshot::none && step(pop); }
+    bool previous();
+    bool treeContains(const Node *node) const;
+    Nodes pathBetween(Node *a, Node *b) const;
+    // Call it from the thread driving the search: the copy starts a new
+    // generation of the published vectors, which are then cloned on write.
+    Snapshot snapshot() const;
+    void traverse(SequentialTraverse &func) const;
+    void traverse(LevelTraverse &func) const;
+
+    template<typename F>
+    auto traverse(F &&func) const -> decltype(func(std::declval<const Node*>()), void())
+    {
+        for (const Node *node : bfsOrder()) {
+            func(node);
+        }
+    }
+
+    template<typename F>
+    auto traverse(F &&func) const -> decltype(func(std::declval<const Level&>(), 0), void())
+    {
+        const auto &nodes = bfsOrder();
+        for (std::size_t d = 0; d + 1 < levelOffsets.size(); d++) {
+            func(Level{nodes.data() + levelOffsets[d], nodes.data() + levelOffsets[d + 1]},
+                 static_cast<int>(d));
+        }
+    }
+
+    const Problem problem;
+    const SearchStrategy strategy;
+    Node *root;
+    Node *current;
+    std::unordered_set<Node*, NodeHash, NodeEqual> uniq;
+    std::set<Node*, OpenCompare> open;
+    Nodes closed;
+    MclStats stats;
+    SearchRecorder *recorder = nullptr;
+private:
+    struct Superseded {
+        Node *node;
+        bool open;
+    };
+
+    bool step(std::uint32_t pop);
+    void record(SearchEvent::Type type, std::uint64_t value = 0)
+    {
+        if (recorder != nullptr) {
+            recorder->record(type, value);
+        }
+    }
+
+    void supersede(Node *node, std::vector<Superseded> &log);
+    void publish(const Node *node);
+    void publishChildren(Node *node);
+    void collapse(const std::vector<Superseded> &superseded, std::vector<Node*> evicted);
+    const std::vector<Node*> &bfsOrder() const;
+    void invalidateOrder() { orderValid = false; }
+    void copyFrom(const SearchTree &other);
+    void updateStats();
+
+    std::vector<std::vector<Superseded>> history;
+    Snapshot published;
+    std::vector<Node*> byId;
+    mutable std::vector<Node*> order;
+    mutable std::vector<std::size_t> levelOffsets;
+    mutable bool orderValid = false;
+};
+
+template<typename Problem>
+SearchTree<Problem>::SearchTree(const Problem &p, SearchStrategy s)
+    : problem(p), strategy{s}, open(OpenCompare{s}), published(p, s)
+{
+    root = new Node(problem.start(), &problem);
+    current = root;
+    uniq.insert(root);
+    closed.push_back(root);
+    byId.push_back(root);
+    publish(root);
+    published.closed.push_back(root->id);
+    MCL_STAT(stats.nodes = 1, updateStats());
+}
+
+template<typename Problem>
+SearchTree<Problem>::SearchTree(const SearchTree &other)
+    : problem(other.problem), strategy{other.strategy}, root{nullptr},
+      open(OpenCompare{other.strategy})
+{
+    copyFrom(other);
+}
+
+// Both trees must search the same problem with the same strategy.
+template<typename Problem>
+SearchTree<Problem> &SearchTree<Problem>::operator=(const SearchTree &other)
+{
+    if (this != &other) {
+        copyFrom(other);
+    }
+    return *this;
+}
+
+template<typename Problem>
+void SearchTree<Problem>::copyFrom(const SearchTree &other)
+{
+    MCL_TRACE_SPAN("SearchTree::copyFrom");
+    delete root;
+    std::unordered_map<const Node*, Node*> copies;
+    root = new Node(other.root->state(), &problem);
+    std::vector<std::pair<const Node*, Node*>> pending = {{other.root, root}};
+    while (!pending.empty()) {
+        const Node *from = pending.back().first;
+        Node *to = pending.back().second;
+        pending.pop_back();
+        to->ccount = from->ccount;
+        to->id = from->id;
+        copies[from] = to;
+        for (const auto &c : from->children) {
+            to->children.emplace_back(new Node(c->state(), to, c->depth, c->index, c->op));
+            pending.push_back({c.get(), to->children.back().get()});
+        }
+    }
+
+    current = copies[other.current];
+    uniq.clear();
+    uniq.rehash(other.uniq.bucket_count());
+    for (const Node *n : other.uniq) {
+        uniq.insert(copies[n]);
+    }
+    open.clear();
+    for (const Node *n : other.open) {
+        open.insert(copies[n]);
+    }
+    closed.clear();
+    for (const Node *n : other.closed) {
+        closed.push_back(copies[n]);
+    }
+    history.clear();
+    for (const auto &log : other.history) {
+        history.emplace_back();
+        for (const Superseded &s : log) {
+            history.back().push_back({copies[s.node], s.open});
+        }
+    }
+    byId.clear();
+    for (const Node *n : other.byId) {
+        byId.push_back(copies[n]);
+    }
+
+    stats = other.stats;
+    published = other.published;
+    invalidateOrder();
+}
+
+template<typename Problem>
+bool SearchTree<Problem>::strategyFromName(const std::string &name, SearchStrategy &strategy)
+{
+    if (name == "greedy") {
+        strategy = SearchStrategy::Greedy;
+    } else if (name == "astar" || name == "a*") {
+        strategy = SearchStrategy::AStar;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+template<typename Problem>
+const char *SearchTree<Problem>::strategyName(SearchStrategy strategy)
+{
+    switch (strategy) {
+    case SearchStrategy::AStar:
+        return "astar";
+    default:
+        return "greedy";
+    }
+}
+
+template<typename Problem>
+bool SearchTree<Problem>::step(std::uint32_t pop)
+{
+    if (isTarget(current)) {
+        return false;
+    }
+
+    MCL_TRACE_SPAN("SearchTree::next");
+    record(SearchEvent::Next);
+    MCL_STAT_TIMER(stats, Next);
+    invalidateOrder();
+    bool expanded = current->iterate() >= 0;
+    if (expanded) {
+        MCL_STAT(stats.expanded++, stats.generated += current->ccount,
+                 stats.nodes += current->ccount);
+        record(SearchEvent::Expand, current->ccount);
+    }
+    std::vector<Superseded> superseded;
+    for (const auto &child : current->children) {
+        auto inserted = uniq.insert(child.get());
+        if (inserted.second) {
+            open.insert(child.get());
+        } else if (strategy == SearchStrategy::AStar &&
+                   child->depth < (*inserted.first)->depth) {
+            MCL_STAT(open.count(*inserted.first) ? stats.decreased++ : stats.reopened++);
+            record(SearchEvent::Supersede, (*inserted.first)->id);
+            supersede(*inserted.first, superseded);
+            uniq.insert(child.get());
+            open.insert(child.get());
+        } else {
+            MCL_STAT(stats.duplicates++);
+            record(SearchEvent::Duplicate, child->index);
+        }
+    }
+
+    if (expanded) {
+        publishChildren(current);
+    }
+    for (const auto &s : superseded) {
+        publish(s.node);
+    }
+    published.version++;
+
+    MCL_STAT(stats.peakOpen = std::max(stats.peakOpen, open.size()));
+    auto first = open.cbegin();
+    if (pop != Snapshot::none) {
+        first = open.cend();
+        if (pop < byId.size()) {
+            auto range = open.equal_range(byId[pop]);
+            auto it = std::find(range.first, range.second, byId[pop]);
+            if (it != range.second) {
+                first = it;
+            }
+        }
+    }
+
+    // Nothing to pop: take the expansion back, as previous() would, so that
+    // every expansion stays paired with a history entry.
+    if (first == open.cend()) {
+        if (expanded) {
+            collapse(superseded, {});
+        }
+        published.version++;
+        MCL_STAT(updateStats());
+        return false;
+    }
+
+    current = *first;
+    open.erase(first);
+    record(SearchEvent::Pop, current->id);
+    closed.push_back(current);
+    publish(current);
+    published.closed.push_back(current->id);
+    history.push_back(std::move(superseded));
+    MCL_STAT(updateStats());
+    return true;
+}
+
+template<typename Problem>
+bool SearchTree<Problem>::previous()
+{
+    MCL_TRACE_SPAN("SearchTree::previous");
+    if (current == root) {
+        return false;
+    }
+
+    record(SearchEvent::Previous);
+    invalidateOrder();
+    Node *prev = closed.back();
+    closed.pop_back();
+    open.insert(prev);
+    current = closed.back();
+    collapse(history.back(), {prev});
+    history.pop_back();
+
+    published.closed.pop_back();
+    published.version++;
+    MCL_STAT(updateStats());
+    return true;
+}
+
+template<typename Problem>
+void SearchTree<Problem>::collapse(const std::vector<Superseded> &superseded,
+                                   std::vector<Node*> evicted)
+{
+    for (const auto &c : current->children) {
+        const auto cptr = c.get();
+        if (treeContains(cptr)) {
+            uniq.erase(cptr);
+            auto it = open.find(cptr);
+            if (it != open.end()) {
+                evicted.push_back(*it);
+                open.erase(it);
+            }
+        }
+    }
+
+    for (Node *n : evicted) {
+        if (n->parent != current) {
+            publish(n);
+        }
+    }
+
+    if (current->ccount > 0) {
+        while (published.nodes.size() > current->children.front()->id) {
+            published.nodes.pop_back();
+            byId.pop_back();
+        }
+    }
+
+    for (auto it = superseded.crbegin(); it != superseded.crend(); ++it) {
+        uniq.insert(it->node);
+        if (it->open) {
+            open.insert(it->node);
+        }
+        publish(it->node);
+    }
+
+    MCL_STAT(stats.nodes -= current->children.size());
+    current->uniterate();
+    publish(current);
+}
+
+template<typename Problem>
+void SearchTree<Problem>::supersede(Node *node, std::vector<Superseded> &log)
+{
+    std::vector<Node*> pending = {node};
+    while (!pending.empty()) {
+        Node *n = pending.back();
+        pending.pop_back();
+        if (!treeContains(n)) {
+            continue;
+        }
+
+        uniq.erase(n);
+        log.push_back({n, open.erase(n) > 0});
+        for (const auto &c : n->children) {
+            pending.push_back(c.get());
+        }
+    }
+}
+
+template<typename Problem>
+void SearchTree<Problem>::publish(const Node *node)
+{
+    Node *n = const_cast<Node*>(node);
+    auto it = open.find(n);
+    typename Snapshot::Node record;
+    static_cast<State&>(record) = node->state();
+    record.depth = node->depth;
+    record.op = node->op;
+    record.ccount = node->ccount;
+    record.parent = node->parent != nullptr ? node->parent->id : Snapshot::none;
+    record.firstChild = node->ccount > 0 ? node->children.front()->id : Snapshot::none;
+    record.inTree = treeContains(node);
+    record.open = it != open.end() && *it == n;
+
+    if (node->id == published.nodes.size()) {
+        published.nodes.push_back(record);
+    } else {
+        published.nodes.edit(node->id) = record;
+    }
+}
+
+template<typename Problem>
+void SearchTree<Problem>::publishChildren(Node *node)
+{
+    for (const auto &c : node->children) {
+        c->id = published.nodes.size();
+        byId.push_back(c.get());
+        publish(c.get());
+    }
+    publish(node);
+}
+
+template<typename Problem>
+typename SearchTree<Problem>::Snapshot SearchTree<Problem>::snapshot() const
+{
+    Snapshot s = published;
+    s.stats = stats;
+    return s;
+}
+
+template<typename Problem>
+void SearchTree<Problem>::updateStats()
+{
+    const std::size_t pointer = sizeof(void*);
+    std::size_t bytes = stats.nodes * (sizeof(Node) + sizeof(std::unique_ptr<Node>));
+    bytes += uniq.bucket_count() * pointer + uniq.size() * 2 * pointer;
+    bytes += open.size() * 4 * pointer;
+    bytes += closed.size() * pointer;
+    stats.bytes = bytes;
+    stats.peakClosed = std::max(stats.peakClosed, closed.size());
+}
+
+template<typename Problem>
+bool SearchTree<Problem>::treeContains(const Node *node) const
+{
+    Node *n = const_cast<Node*>(node);
+    auto it = uniq.find(n);
+    return it != uniq.end() && *it == n;
+}
+
+template<typename Problem>
+typename SearchTree<Problem>::Nodes SearchTree<Problem>::pathBetween(Node *a, Node *b) const
+{
+    MCL_TRACE_SPAN("SearchTree::pathBetween");
+    if (a == b) {
+        return {a};
+    }
+
+    Nodes bAsc;
+    for (Node *n = b; n != nullptr; n = n->parent) {
+        bAsc.push_front(n);
+        if (n == a) {
+            return bAsc;
+        }
+    }
+
+    Nodes path;
+    typename Nodes::const_iterator it;
+    for (Node *n = a; n != nullptr; n = n->parent) {
+        it = std::find(bAsc.cbegin(), bAsc.cend(), n);
+        if (it != bAsc.cend()) {
+            break;
+        }
+        path.push_back(n);
+    }
+
+    if (it == bAsc.cend()) {
+        return Nodes();
+    }
+
+    path.insert(path.cend(), it, bAsc.cend());
+    return path;
+}
+
+template<typename Problem>
+void SearchTree<Problem>::traverse(SequentialTraverse &func) const
+{
+    Nodes nodes = {root};
+    while (!nodes.empty()) {
+        Nodes current;
+        current.swap(nodes);
+
+        for (const auto &n : current) {
+            for (const auto &c : n->children) {
+                nodes.push_back(c.get());
+            }
+            func(n);
+        }
+    }
+}
+
+template<typename Problem>
+void SearchTree<Problem>::traverse(LevelTraverse &func) const
+{
+    Nodes nodes = {root};
+    int depth = 0;
+
+    while (!nodes.empty()) {
+        func(nodes, depth++);
+        Nodes parents;
+        parents.swap(nodes);
+
+        for (const auto &p : parents) {
+            if (!(p->ccount > 0)) {
+                continue;
+            }
+
+            for (const auto &c : p->children) {
+                if (treeContains(c.get())) {
+                    nodes.push_back(c.get());
+                }
+            }
+        }
+    }
+}
+
+template<typename Problem>
+const std::vector<typename SearchTree<Problem>::Node*> &SearchTree<Problem>::bfsOrder() const
+{
+    if (orderValid) {
+        return order;
+    }
+
+    MCL_TRACE_SPAN("SearchTree::bfsOrder");
+    order.clear();
+    levelOffsets.clear();
+    order.push_back(root);
+    levelOffsets.push_back(0);
+
+    for (std::size_t first = 0; first < order.size(); ) {
+        std::size_t last = order.size();
+        levelOffsets.push_back(last);
+        for (std::size_t i = first; i < last; i++) {
+            const Node *p = order[i];
+            if (!(p->ccount > 0)) {
+                continue;
+            }
+
+            for (const auto &c : p->children) {
+                if (treeContains(c.get())) {
+                    order.push_back(c.get());
+                }
+            }
+        }
+        first = last;
+    }
+
+    orderValid = true;
+    return order;
+}
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef SEARCHVIEW_HPP
+#define SEARCHVIEW_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "mcl.hpp"
+#include "recorder.hpp"
+
+// A search tree as MclWidget and TreeExporter see it, whatever its problem.
+// Nodes are the tree's own nodes, handed out as opaque pointers.
+class SearchView {
+public:
+    using Node = const void*;
+    using Nodes = std::vector<Node>;
+
+    virtual ~SearchView() { }
+
+    virtual Node root() const = 0;
+    virtual Node current() const = 0;
+    virtual Node parent(Node n) const = 0;
+    virtual int depth(Node n) const = 0;
+    virtual int op(Node n) const = 0;
+    virtual std::uint32_t id(Node n) const = 0;
+    virtual std::uint64_t key(Node n) const = 0;
+    virtual int priority(Node n) const = 0;
+    virtual bool expanded(Node n) const = 0;
+    virtual bool isTarget(Node n) const = 0;
+    virtual std::string label(Node n) const = 0;
+    // The state as JSON members, without braces.
+    virtual std::string jsonFields(Node n) const = 0;
+
+    // Appends the children that are part of the tree and returns how many
+    // others were generated.
+    virtual int children(Node n, Nodes &inTree) const = 0;
+    // Nodes of the tree that children of n turned out to repeat.
+    virtual Nodes repeatedBy(Node n) const = 0;
+    virtual Nodes pathToCurrent() const = 0;
+    virtual void traverse(const std::function<void(Node)> &func) const = 0;
+    virtual void traverse(const std::function<void(const Nodes&, int)> &func) const = 0;
+
+    virtual MclStats &stats() = 0;
+    virtual bool next() = 0;
+    virtual bool previous() = 0;
+    virtual void setRecorder(SearchRecorder *recorder) = 0;
+
+    // Replays a log against the tree; false if it records another search.
+    virtual bool startReplay(const SearchLog &log) = 0;
+    virtual void prepareReplay() = 0;
+    virtual void seekReplay(std::uint64_t position) = 0;
+    virtual std::uint64_t replayDivergent() const = 0;
+};
+
+// A state's label is toString() from the problem if it has one, or else the
+// state's own conversion to std::string.
+template<typename Problem, typename = void>
+struct SearchLabel {
+    static std::string get(const Problem &, const typename Problem::State &s) { return s; }
+};
+
+template<typename Problem>
+struct SearchLabel<Problem, decltype(void(std::declval<const Problem&>().toString(
+                                std::declval<const typename Problem::State&>())))> {
+    static std::string get(const Problem &p, const typename Problem::State &s)
+    {
+        return p.toString(s);
+    }
+};
+
+template<typename Problem>
+struct SearchJson {
+    static std::string get(const Problem &p, const typename Problem::State &s)
+    {
+        std::string json = "\"state\":\"";
+        for (char ch : SearchLabel<Problem>::get(p, s)) {
+            if (ch == '"' || ch == '\\') {
+                json += '\\';
+            }
+            json += ch;
+        }
+        return json + "\"";
+    }
+};
+
+template<>
+struct SearchJson<MclProblem> {
+    static std::string get(const MclProblem &, const MclState &s)
+    {
+        std::ostringstream os;
+        os << "\"m\":" << s.m << ",\"c\":" << s.c << ",\"l\":" << s.l;
+        return os.str();
+    }
+};
+
+template<typename Problem>
+class SearchViewFor : public SearchView {
+public:
+    using Tree = SearchTree<Problem>;
+    using TreeNode = typename Tree::Node;
+
+    // header is what recordings of this search start with.
+    explicit SearchViewFor(const Problem &p, SearchStrategy s,
+                           const std::vector<std::uint64_t> &h = {})
+        : owned(new Tree(p, s)), tree(*owned), header{h}
+    {
+    }
+
+    explicit SearchViewFor(Tree &t, const std::vector<std::uint64_t> &h = {})
+        : tree(t), header{h}
+    {
+    }
+
+    Node root() const override { return tree.root; }
+    Node current() const override { return tree.current; }
+    Node parent(Node n) const override { return node(n)->parent; }
+    int depth(Node n) const override { return node(n)->depth; }
+    int op(Node n) const override { return node(n)->op; }
+    std::uint32_t id(Node n) const override { return node(n)->id; }
+    std::uint64_t key(Node n) const override { return node(n)->key(); }
+    int priority(Node n) const override { return node(n)->priority(); }
+    bool expanded(Node n) const override { return node(n)->ccount > 0; }
+    bool isTarget(Node n) const override { return tree.isTarget(node(n)); }
+
+    std::string label(Node n) const override
+    {
+        return SearchLabel<Problem>::get(tree.problem, *node(n));
+    }
+
+    std::string jsonFields(Node n) const override
+    {
+        return SearchJson<Problem>::get(tree.problem, *node(n));
+    }
+
+    int children(Node n, Nodes &inTree) const override
+    {
+        int others = 0;
+        for (const auto &c : node(n)->children) {
+            if (tree.treeContains(c.get())) {
+                inTree.push_back(c.get());
+            } else {
+                others++;
+            }
+        }
+        return others;
+    }
+
+    Nodes repeatedBy(Node n) const override
+    {
+        Nodes nodes;
+        for (const auto &c : node(n)->children) {
+            auto it = tree.uniq.find(c.get());
+            if (it != tree.uniq.end() && *it != c.get()) {
+                nodes.push_back(*it);
+            }
+        }
+        return nodes;
+    }
+
+    Nodes pathToCurrent() const override
+    {
+        auto path = tree.pathBetween(tree.root, tree.current);
+        return Nodes(path.cbegin(), path.cend());
+    }
+
+    void traverse(const std::function<void(Node)> &func) const override
+    {
+        tree.traverse([&func](const TreeNode *n) { func(n); });
+    }
+
+    void traverse(const std::function<void(const Nodes&, int)> &func) const override
+    {
+        Nodes nodes;
+        tree.traverse([&](const typename Tree::Level &level, int depth) {
+            nodes.assign(level.begin(), level.end());
+            func(nodes, depth);
+        });
+    }
+
+    MclStats &stats() override { return tree.stats; }
+    bool next() override { return tree.next(); }
+    bool previous() override { return tree.previous(); }
+    void setRecorder(SearchRecorder *recorder) override { tree.recorder = recorder; }
+
+    bool startReplay(const SearchLog &log) override
+    {
+        if (log.header != header) {
+            return false;
+        }
+        tree.recorder = nullptr;
+        replay.reset(new SearchReplay<Tree>(log, tree));
+        return true;
+    }
+
+    void prepareReplay() override { replay->prepare(); }
+    void seekReplay(std::uint64_t position) override { replay->seek(position); }
+    std::uint64_t replayDivergent() const override { return replay->divergent(); }
+private:
+    static const TreeNode *node(Node n) { return static_cast<const TreeNode*>(n); }
+
+    std::unique_ptr<Tree> owned;
+    Tree &tree;
+    std::vector<std::uint64_t> header;
+    std::unique_ptr<SearchReplay<Tree>> replay;
+};
+
+using MclView = SearchViewFor<MclProblem>;
+
+#endif
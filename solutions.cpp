@@ -0,0 +1,222 @@
+#include "search.hpp"
+#include <algorithm>
+#include <cctype>
+
+MclBigUint::MclBigUint(std::uint32_t value)
+{
+    while (value > 0) {
+        limbs.push_back(value % base);
+        value /= base;
+    }
+}
+
+bool MclBigUint::fromString(const std::string &text, MclBigUint &value)
+{
+    if (text.empty() || !std::all_of(text.cbegin(), text.cend(),
+                                     [](char ch) { return std::isdigit(ch); })) {
+        return false;
+    }
+
+    value.limbs.clear();
+    for (std::size_t end = text.size(); end > 0; ) {
+        std::size_t start = end >= 9 ? end - 9 : 0;
+        value.limbs.push_back(std::stoul(text.substr(start, end - start)));
+        end = start;
+    }
+
+    while (!value.limbs.empty() && value.limbs.back() == 0) {
+        value.limbs.pop_back();
+    }
+    return true;
+}
+
+MclBigUint &MclBigUint::operator+=(const MclBigUint &other)
+{
+    if (other.limbs.size() > limbs.size()) {
+        limbs.resize(other.limbs.size(), 0);
+    }
+
+    std::uint32_t carry = 0;
+    for (std::size_t i = 0; i < limbs.size() && (carry || i < other.limbs.size()); i++) {
+        std::uint32_t sum = limbs[i] + carry + (i < other.limbs.size() ? other.limbs[i] : 0);
+        carry = sum >= base;
+        limbs[i] = sum - carry * base;
+    }
+
+    if (carry) {
+        limbs.push_back(carry);
+    }
+    return *this;
+}
+
+MclBigUint &MclBigUint::operator-=(const MclBigUint &other)
+{
+    std::int64_t borrow = 0;
+    for (std::size_t i = 0; i < limbs.size() && (borrow || i < other.limbs.size()); i++) {
+        std::int64_t diff = std::int64_t(limbs[i]) - borrow -
+                            (i < other.limbs.size() ? other.limbs[i] : 0);
+        borrow = diff < 0;
+        limbs[i] = std::uint32_t(diff + borrow * base);
+    }
+
+    while (!limbs.empty() && limbs.back() == 0) {
+        limbs.pop_back();
+    }
+    return *this;
+}
+
+bool MclBigUint::operator<(const MclBigUint &other) const
+{
+    if (limbs.size() != other.limbs.size()) {
+        return limbs.size() < other.limbs.size();
+    }
+    return std::lexicographical_compare(limbs.crbegin(), limbs.crend(),
+                                        other.limbs.crbegin(), other.limbs.crend());
+}
+
+MclBigUint::operator std::string() const
+{
+    if (limbs.empty()) {
+        return "0";
+    }
+
+    std::string text = std::to_string(limbs.back());
+    for (auto it = limbs.crbegin() + 1; it != limbs.crend(); ++it) {
+        std::string limb = std::to_string(*it);
+        text += std::string(9 - limb.size(), '0') + limb;
+    }
+    return text;
+}
+
+MclSolutions::MclSolutions(const MclInstance &inst)
+    : space(inst), dist(space.size(), -1), counts(space.size())
+{
+    std::uint64_t start = space.key(space.start());
+    std::uint64_t goal = space.key(space.goal());
+    std::vector<std::uint64_t> order = {start};
+    dist[start] = 0;
+
+    for (std::size_t i = 0; i < order.size() && dist[goal] < 0; ) {
+        for (std::size_t end = order.size(); i < end; i++) {
+            int d = dist[order[i]];
+            space.successors(space.state(order[i]), [&](const MclState &s) {
+                std::uint64_t k = space.key(s);
+                if (dist[k] < 0) {
+                    dist[k] = d + 1;
+                    order.push_back(k);
+                }
+            });
+        }
+    }
+
+    length_ = dist[goal];
+    if (length_ < 0) {
+        return;
+    }
+
+    counts[goal] = 1;
+    for (auto it = order.crbegin(); it != order.crend(); ++it) {
+        if (dist[*it] >= length_) {
+            continue;
+        }
+
+        MclBigUint &count = counts[*it];
+        for (std::uint64_t k : layerSuccessors(*it)) {
+            count += counts[k];
+        }
+    }
+}
+
+const MclBigUint &MclSolutions::count() const
+{
+    return counts[space.key(space.start())];
+}
+
+std::vector<std::uint64_t> MclSolutions::layerSuccessors(std::uint64_t key) const
+{
+    std::vector<std::uint64_t> keys;
+    int d = dist[key];
+    space.successors(space.state(key), [&](const MclState &s) {
+        std::uint64_t k = space.key(s);
+        if (dist[k] == d + 1 && d + 1 <= length_ && !counts[k].isZero()) {
+            keys.push_back(k);
+        }
+    });
+    return keys;
+}
+
+MclPath MclSolutions::at(MclBigUint index) const
+{
+    MclPath path;
+    if (!solvable() || !(index < count())) {
+        return path;
+    }
+
+    std::uint64_t key = space.key(space.start());
+    path.push_back(space.state(key));
+    for (int d = 0; d < length_; d++) {
+        for (std::uint64_t k : layerSuccessors(key)) {
+            if (index < counts[k]) {
+                key = k;
+                break;
+            }
+            index -= counts[k];
+        }
+        path.push_back(space.state(key));
+    }
+    return path;
+}
+
+bool MclSolutions::descend(std::size_t branch)
+{
+    while (true) {
+        Frame &top = stack.back();
+        std::vector<std::uint64_t> keys = layerSuccessors(top.key);
+        if (dist[top.key] == length_) {
+            return true;
+        } else if (branch >= keys.size()) {
+            return false;
+        }
+
+        top.branch = branch;
+        stack.push_back({keys[branch], 0});
+        branch = 0;
+    }
+}
+
+bool MclSolutions::next(MclPath &path)
+{
+    if (!solvable()) {
+        return false;
+    }
+
+    bool found;
+    if (!started) {
+        started = true;
+        stack = {{space.key(space.start()), 0}};
+        found = descend(0);
+    } else {
+        found = false;
+        while (!found && stack.size() > 1) {
+            stack.pop_back();
+            found = descend(stack.back().branch + 1);
+        }
+    }
+
+    if (!found) {
+        stack.clear();
+        return false;
+    }
+
+    path.clear();
+    for (const Frame &frame : stack) {
+        path.push_back(space.state(frame.key));
+    }
+    return true;
+}
+
+void MclSolutions::rewind()
+{
+    started = false;
+    stack.clear();
+}
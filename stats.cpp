@@ -0,0 +1,98 @@
+#include "stats.hpp"
+#include <algorithm>
+#include <sstream>
+
+void MclStats::Timing::add(std::uint64_t ns)
+{
+    count++;
+    totalNs += ns;
+    lastNs = ns;
+    maxNs = std::max(maxNs, ns);
+}
+
+double MclStats::Timing::meanNs() const
+{
+    return count > 0 ? static_cast<double>(totalNs) / count : 0.0;
+}
+
+MclStats::Scope::Scope(Timing &t)
+    : timing{t}, start{std::chrono::steady_clock::now()}
+{
+}
+
+MclStats::Scope::~Scope()
+{
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    timing.add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+const char *MclStats::timerName(Timer timer)
+{
+    switch (timer) {
+    case Next:
+        return "next";
+    case Layout:
+        return "layout";
+    case Paint:
+        return "paint";
+    default:
+        return "";
+    }
+}
+
+double MclStats::bytesPerNode() const
+{
+    return nodes > 0 ? static_cast<double>(bytes) / nodes : 0.0;
+}
+
+std::string MclStats::csv() const
+{
+    std::ostringstream os;
+    os << "metric,value\n"
+       << "expanded," << expanded << "\n"
+       << "generated," << generated << "\n"
+       << "duplicates," << duplicates << "\n"
+       << "decreased," << decreased << "\n"
+       << "reopened," << reopened << "\n"
+       << "nodes," << nodes << "\n"
+       << "bytes_per_node," << bytesPerNode() << "\n"
+       << "peak_open," << peakOpen << "\n"
+       << "peak_closed," << peakClosed << "\n";
+
+    for (int t = 0; t < TimerCount; t++) {
+        const Timing &timing = timings[t];
+        const char *name = timerName(static_cast<Timer>(t));
+        os << name << "_count," << timing.count << "\n"
+           << name << "_mean_ns," << timing.meanNs() << "\n"
+           << name << "_max_ns," << timing.maxNs << "\n";
+    }
+
+    return os.str();
+}
+
+std::string MclStats::json() const
+{
+    std::ostringstream os;
+    os << "{\"expanded\":" << expanded
+       << ",\"generated\":" << generated
+       << ",\"duplicates\":" << duplicates
+       << ",\"decreased\":" << decreased
+       << ",\"reopened\":" << reopened
+       << ",\"nodes\":" << nodes
+       << ",\"bytes_per_node\":" << bytesPerNode()
+       << ",\"peak_open\":" << peakOpen
+       << ",\"peak_closed\":" << peakClosed
+       << ",\"timings\":{";
+
+    for (int t = 0; t < TimerCount; t++) {
+        const Timing &timing = timings[t];
+        os << (t > 0 ? "," : "") << "\"" << timerName(static_cast<Timer>(t))
+           << "\":{\"count\":" << timing.count
+           << ",\"total_ns\":" << timing.totalNs
+           << ",\"mean_ns\":" << timing.meanNs()
+           << ",\"max_ns\":" << timing.maxNs << "}";
+    }
+
+    os << "}}\n";
+    return os.str();
+}
@@ -0,0 +1,62 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#ifdef MCL_STATS
+#define MCL_STAT(...) __VA_ARGS__
+#define MCL_STAT_TIMER(stats, timer) \
+    MclStats::Scope statScope_{(stats).timings[MclStats::timer]}
+#else
+#define MCL_STAT(...) ((void)0)
+#define MCL_STAT_TIMER(stats, timer) ((void)0)
+#endif
+
+struct MclStats {
+#ifdef MCL_STATS
+    static constexpr bool const enabled = true;
+#else
+    static constexpr bool const enabled = false;
+#endif
+
+    enum Timer { Next, Layout, Paint, TimerCount };
+
+    struct Timing {
+        void add(std::uint64_t ns);
+        double meanNs() const;
+
+        std::uint64_t count = 0;
+        std::uint64_t totalNs = 0;
+        std::uint64_t lastNs = 0;
+        std::uint64_t maxNs = 0;
+    };
+
+    class Scope {
+    public:
+        explicit Scope(Timing &t);
+        ~Scope();
+    private:
+        Timing &timing;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    static const char *timerName(Timer timer);
+    double bytesPerNode() const;
+    std::string csv() const;
+    std::string json() const;
+
+    std::uint64_t expanded = 0;
+    std::uint64_t generated = 0;
+    std::uint64_t duplicates = 0;
+    std::uint64_t decreased = 0;
+    std::uint64_t reopened = 0;
+    std::size_t nodes = 0;
+    std::size_t bytes = 0;
+    std::size_t peakOpen = 0;
+    std::size_t peakClosed = 0;
+    Timing timings[TimerCount];
+};
+
+#endif
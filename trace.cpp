@@ -0,0 +1,154 @@
+#include "trace.hpp"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct Event {
+    const char *name;
+    std::uint64_t start;
+    std::uint64_t end;
+};
+
+struct Buffer {
+    explicit Buffer(int i) : tid{i}, events(Trace::bufferCapacity) { }
+
+    int tid;
+    std::string name;
+    std::vector<Event> events;
+    std::atomic<std::uint64_t> head{0};
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Buffer>> buffers;
+    std::string fileName;
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+Registry &registry()
+{
+    static Registry r;
+    return r;
+}
+
+Buffer &threadBuffer()
+{
+    thread_local std::shared_ptr<Buffer> buffer = [] {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.buffers.push_back(std::make_shared<Buffer>(r.buffers.size() + 1));
+        return r.buffers.back();
+    }();
+    return *buffer;
+}
+
+void writeString(std::ostream &os, const std::string &s)
+{
+    os << '"';
+    for (char ch : s) {
+        if (ch == '"' || ch == '\\') {
+            os << '\\';
+        }
+        os << ch;
+    }
+    os << '"';
+}
+
+}
+
+std::atomic<bool> Trace::active{false};
+
+void Trace::start(const std::string &fileName)
+{
+    Registry &r = registry();
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.fileName = fileName;
+    }
+    setThreadName("main");
+    active.store(true, std::memory_order_relaxed);
+}
+
+bool Trace::stop()
+{
+    if (!active.exchange(false)) {
+        return true;
+    }
+
+    std::string fileName = registry().fileName;
+    if (fileName == "-") {
+        write(std::cout);
+        return bool(std::cout);
+    }
+
+    std::ofstream os(fileName);
+    write(os);
+    if (!os) {
+        std::cerr << "Cannot write trace to " << fileName << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Trace::setThreadName(const std::string &name)
+{
+    Buffer &buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    buffer.name = name;
+}
+
+void Trace::write(std::ostream &os)
+{
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    bool first = true;
+    auto separator = [&os, &first]() -> std::ostream& {
+        os << (first ? "\n" : ",\n");
+        first = false;
+        return os;
+    };
+
+    std::ios::fmtflags flags = os.flags();
+    os << std::fixed << std::setprecision(3);
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (const auto &buffer : r.buffers) {
+        if (!buffer->name.empty()) {
+            separator() << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":"
+                        << buffer->tid << ",\"args\":{\"name\":";
+            writeString(os, buffer->name);
+            os << "}}";
+        }
+
+        std::uint64_t head = buffer->head.load(std::memory_order_acquire);
+        std::uint64_t oldest = head > bufferCapacity ? head - bufferCapacity : 0;
+        for (std::uint64_t i = oldest; i < head; i++) {
+            const Event &e = buffer->events[i % bufferCapacity];
+            separator() << "{\"ph\":\"X\",\"name\":\"" << e.name
+                        << "\",\"pid\":1,\"tid\":" << buffer->tid
+                        << ",\"ts\":" << e.start / 1000.0
+                        << ",\"dur\":" << (e.end - e.start) / 1000.0 << "}";
+        }
+    }
+    os << "\n]}\n";
+    os.flags(flags);
+}
+
+std::uint64_t Trace::now()
+{
+    auto elapsed = std::chrono::steady_clock::now() - registry().epoch;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+void Trace::record(const char *name, std::uint64_t start, std::uint64_t end)
+{
+    Buffer &buffer = threadBuffer();
+    std::uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head % bufferCapacity] = {name, start, end};
+    buffer.head.store(head + 1, std::memory_order_release);
+}
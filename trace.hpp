@@ -0,0 +1,55 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#define MCL_TRACE_CONCAT_(a, b) a##b
+#define MCL_TRACE_CONCAT(a, b) MCL_TRACE_CONCAT_(a, b)
+#define MCL_TRACE_SPAN(name) \
+    Trace::Span MCL_TRACE_CONCAT(traceSpan_, __LINE__){name}
+
+class Trace {
+public:
+    class Span {
+    public:
+        explicit Span(const char *n)
+            : name{Trace::enabled() ? n : nullptr}, start{name ? Trace::now() : 0}
+        {
+        }
+
+        ~Span()
+        {
+            if (name != nullptr) {
+                Trace::record(name, start, Trace::now());
+            }
+        }
+
+        Span(const Span&) = delete;
+        Span &operator=(const Span&) = delete;
+    private:
+        const char *name;
+        std::uint64_t start;
+    };
+
+    static constexpr std::size_t const bufferCapacity = 1 << 16;
+
+    static bool enabled()
+    {
+        return active.load(std::memory_order_relaxed);
+    }
+
+    static void start(const std::string &fileName);
+    static bool stop();
+    static void setThreadName(const std::string &name);
+    static void write(std::ostream &os);
+private:
+    static std::uint64_t now();
+    static void record(const char *name, std::uint64_t start, std::uint64_t end);
+
+    static std::atomic<bool> active;
+};
+
+#endif